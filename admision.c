@@ -0,0 +1,191 @@
+// admision.c
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "admision.h"
+
+#define ADM_CLIENTES   256            // Cubetas de límite por cliente (tabla hash)
+#define ADM_OCIOSA_NS  1000000000LL   // Tras 1 s sin uso la cubeta ya está llena: reutilizable
+
+// Petición en espera con su plazo (ns de CLOCK_MONOTONIC, 0 = sin plazo)
+typedef struct {
+    Request req;
+    long long deadline;
+} Pending;
+
+// Cola circular de una clase, al estilo de TaskBuffer
+typedef struct {
+    Pending *slots;
+    int cap, in, out, count;
+} AdmQueue;
+
+// Cubeta de fichas de un cliente
+typedef struct {
+    char client[FIFO_NAME_LEN];
+    double tokens;
+    long long last;
+} Bucket;
+
+static Pending interactive_slots[ADM_MAX_INTERACTIVA];
+static Pending bulk_slots[ADM_MAX_MASIVA];
+static AdmQueue queues[2] = {
+    { interactive_slots, ADM_MAX_INTERACTIVA, 0, 0, 0 },
+    { bulk_slots, ADM_MAX_MASIVA, 0, 0, 0 },
+};
+static pthread_mutex_t adm_mux = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t adm_cond = PTHREAD_COND_INITIALIZER;
+static int interactive_streak = 0;
+static int stopping = 0;
+static long long deadline_ns[2] = { 0, 0 };
+
+static Bucket buckets[ADM_CLIENTES];
+static pthread_mutex_t bucket_mux = PTHREAD_MUTEX_INITIALIZER;
+static int rate_limit = 0;
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void adm_init(int rate, int deadline_ms) {
+    rate_limit = rate > 0 ? rate : 0;
+    if (deadline_ms > 0) {
+        deadline_ns[ADM_INTERACTIVA] = deadline_ms * 1000000LL;
+        deadline_ns[ADM_MASIVA] = deadline_ms * 10000000LL;
+    }
+}
+
+AdmClass adm_class(OpType op) {
+    if (op == OP_RENOVAR || op == OP_DEVOLVER) {
+        return ADM_MASIVA;
+    }
+    return ADM_INTERACTIVA;
+}
+
+// Cubeta de client (bucket_mux tomado). Tabla con sondeo lineal: se
+// recorre desde su hash hasta encontrarla o dar con un hueco libre. Si no
+// hay hueco se reutiliza la más antigua de las que llevan ADM_OCIOSA_NS sin
+// uso (a esas alturas ya estaría llena, no se pierde nada); si todas están
+// en uso devuelve NULL.
+static Bucket *find_bucket(const char *client, long long now) {
+    unsigned h = 2166136261u;   // FNV-1a
+    for (const char *p = client; *p; p++) {
+        h = (h ^ (unsigned char)*p) * 16777619u;
+    }
+    Bucket *oldest = NULL;
+    for (int i = 0; i < ADM_CLIENTES; i++) {
+        Bucket *b = &buckets[(h + i) % ADM_CLIENTES];
+        if (b->last == 0) {
+            oldest = b;         // hueco libre: el cliente no está más adelante
+            break;
+        }
+        if (strcmp(b->client, client) == 0) {
+            return b;
+        }
+        if (now - b->last >= ADM_OCIOSA_NS && (!oldest || b->last < oldest->last)) {
+            oldest = b;
+        }
+    }
+    if (oldest) {
+        // Cliente nuevo: empieza con la cubeta llena
+        strncpy(oldest->client, client, FIFO_NAME_LEN - 1);
+        oldest->client[FIFO_NAME_LEN - 1] = '\0';
+        oldest->tokens = rate_limit;
+        oldest->last = now;
+    }
+    return oldest;
+}
+
+int adm_allow(const char *client) {
+    if (rate_limit == 0) {
+        return 1;
+    }
+    long long now = now_ns();
+
+    pthread_mutex_lock(&bucket_mux);
+    Bucket *b = find_bucket(client, now);
+    if (!b) {
+        // Tabla llena de clientes activos: sin cubeta no hay límite que
+        // aplicar, así que se rechaza en vez de dejarlo pasar sin control
+        pthread_mutex_unlock(&bucket_mux);
+        return 0;
+    }
+    b->tokens += (now - b->last) * 1e-9 * rate_limit;
+    if (b->tokens > rate_limit) {
+        b->tokens = rate_limit;
+    }
+    b->last = now;
+    int ok = b->tokens >= 1.0;
+    if (ok) {
+        b->tokens -= 1.0;
+    }
+    pthread_mutex_unlock(&bucket_mux);
+    return ok;
+}
+
+int adm_submit(const Request *req) {
+    // Sin FIFO propio no se distingue a un cliente de otro: sólo los acota
+    // el tamaño de la cola. Q (salir) no cuenta contra el límite.
+    if (req->op != OP_SALIR && req->reply_fifo[0] && !adm_allow(req->reply_fifo)) {
+        return -1;
+    }
+    AdmClass c = adm_class(req->op);
+    AdmQueue *q = &queues[c];
+
+    pthread_mutex_lock(&adm_mux);
+    if (stopping || q->count == q->cap) {
+        // Cola llena: rechazar ya en vez de dejarla crecer
+        pthread_mutex_unlock(&adm_mux);
+        return -1;
+    }
+    Pending *p = &q->slots[q->in];
+    p->req = *req;
+    p->deadline = deadline_ns[c] ? now_ns() + deadline_ns[c] : 0;
+    q->in = (q->in + 1) % q->cap;
+    q->count++;
+    pthread_cond_signal(&adm_cond);
+    pthread_mutex_unlock(&adm_mux);
+    return 0;
+}
+
+int adm_next(Request *req, int *late) {
+    pthread_mutex_lock(&adm_mux);
+    while (!stopping && queues[0].count == 0 && queues[1].count == 0) {
+        pthread_cond_wait(&adm_cond, &adm_mux);
+    }
+    AdmQueue *iq = &queues[ADM_INTERACTIVA];
+    AdmQueue *bq = &queues[ADM_MASIVA];
+    if (iq->count == 0 && bq->count == 0) {
+        pthread_mutex_unlock(&adm_mux);
+        return -1;
+    }
+
+    // Prioridad estricta al mostrador, salvo una masiva cada
+    // ADM_MASIVA_CADA interactivas para que las masivas no se mueran de hambre
+    AdmQueue *q;
+    if (iq->count > 0 && (bq->count == 0 || interactive_streak < ADM_MASIVA_CADA)) {
+        q = iq;
+        interactive_streak++;
+    } else {
+        q = bq;
+        interactive_streak = 0;
+    }
+    Pending *p = &q->slots[q->out];
+    *req = p->req;
+    // Q no vence nunca: sólo responde BYE y el cliente lo espera para salir
+    *late = p->req.op != OP_SALIR &&
+            (stopping || (p->deadline && now_ns() > p->deadline));
+    q->out = (q->out + 1) % q->cap;
+    q->count--;
+    pthread_mutex_unlock(&adm_mux);
+    return 0;
+}
+
+void adm_shutdown(void) {
+    pthread_mutex_lock(&adm_mux);
+    stopping = 1;
+    pthread_cond_broadcast(&adm_cond);
+    pthread_mutex_unlock(&adm_mux);
+}
@@ -0,0 +1,44 @@
+#ifndef ADMISION_H
+#define ADMISION_H
+
+#include "common.h"
+
+// Clases de petición: las de mostrador (P, H, C, M, Q) se atienden antes
+// que las masivas (R, D), que suelen llegar en ráfagas de devoluciones.
+typedef enum {
+    ADM_INTERACTIVA = 0,
+    ADM_MASIVA      = 1
+} AdmClass;
+
+#define ADM_MAX_INTERACTIVA   128    // Peticiones de mostrador en espera
+#define ADM_MAX_MASIVA        512    // Peticiones masivas en espera
+#define ADM_MASIVA_CADA       8      // Tras 8 interactivas seguidas, una masiva
+
+// Prepara las colas. rate: peticiones por segundo y cliente (0 = sin límite);
+// deadline_ms: plazo de las interactivas, las masivas tienen 10 veces más
+// (0 = sin plazo).
+void adm_init(int rate, int deadline_ms);
+
+// Clase de una operación
+AdmClass adm_class(OpType op);
+
+// Límite por cliente (cubeta de fichas, clave = FIFO o región del cliente).
+// Devuelve 1 si la petición puede pasar, 0 si el cliente va demasiado rápido.
+int adm_allow(const char *client);
+
+// Aplica el límite del cliente y encola la petición en su clase sin
+// bloquear. Las peticiones sin FIFO de respuesta y Q no tienen límite por
+// cliente, y Q nunca vence en la cola. Devuelve 0 si quedó encolada, -1 si
+// hay que rechazarla (con la cola llena también Q: el llamador la atiende).
+int adm_submit(const Request *req);
+
+// Saca la siguiente petición (bloquea si no hay). *late indica que venció
+// su plazo, o que el receptor se está cerrando, y no debe ejecutarse
+// (nunca en Q).
+// Devuelve -1 cuando se llamó a adm_shutdown() y las colas están vacías.
+int adm_next(Request *req, int *late);
+
+// Detiene el servicio: lo pendiente se entrega a adm_next() como vencido
+void adm_shutdown(void);
+
+#endif // ADMISION_H
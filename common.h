@@ -15,7 +15,10 @@ typedef enum {
     OP_PRESTAMO,
     OP_RENOVAR,
     OP_DEVOLVER,
-    OP_SALIR
+    OP_SALIR,
+    OP_RESERVAR,
+    OP_MEMORIA,
+    OP_CONSULTAR
 } OpType;
 
 // Petición recibida
@@ -23,6 +26,7 @@ typedef struct {
     OpType op;
     char title[MAX_TITLE_LEN];
     int isbn;
+    char reply_fifo[FIFO_NAME_LEN];   // FIFO de respuesta del cliente ("" = FIFO común)
 } Request;
 
 // Registro de log
@@ -31,7 +35,8 @@ typedef struct LogEntry {
     char title[MAX_TITLE_LEN];
     int isbn;
     int ejemplar;
-    char date[DATE_STR_LEN];
+    char date[DATE_STR_LEN];      // P/R: fecha de devolución; D: fecha del ejemplar
+    char op_date[DATE_STR_LEN];   // día en que se registró la operación
     struct LogEntry *next;
 } LogEntry;
 
@@ -50,9 +55,26 @@ typedef struct {
     Ejemplar ejemplares[MAX_EJEMPLARES];
 } Book;
 
+// Cliente en espera de un ejemplar (cola FIFO de reservas por libro)
+typedef struct HoldEntry {
+    char reply_fifo[FIFO_NAME_LEN];
+    struct HoldEntry *next;
+} HoldEntry;
+
+// Reserva encolada, guardada para replicarla en el mismo orden que el log
+typedef struct HoldEvent {
+    int isbn;
+    char reply_fifo[FIFO_NAME_LEN];
+    LogEntry *after;              // cabeza del log cuando se encoló
+    struct HoldEvent *next;       // evento anterior (la lista crece por la cabeza)
+} HoldEvent;
+
 // Nodo de lista enlazada de libros
 typedef struct BookNode {
     Book book;
+    HoldEntry *holds_head;   // primer cliente en espera (protegido por db_mux)
+    HoldEntry *holds_tail;
+    unsigned long version;   // último cambio de estado (db_changes, db_mux)
     struct BookNode *next;
 } BookNode;
 
@@ -61,6 +83,8 @@ typedef struct {
     OpType op;
     int isbn;
     int ejemplar;
+    char date[DATE_STR_LEN];          // OP_RESERVAR: fecha de devolución asignada
+    char reply_fifo[FIFO_NAME_LEN];   // OP_RESERVAR: cliente a avisar
 } Task;
 
 // Buffer circular
@@ -72,6 +96,12 @@ typedef struct {
     pthread_cond_t not_full;
 } TaskBuffer;
 
+// Fragmento (shard) al que pertenece un ISBN cuando el catálogo se reparte
+// entre nshards receptores; lo usan el receptor (-k) y el enrutador.
+static inline int isbn_shard(int isbn, int nshards) {
+    return (int)(((unsigned)isbn * 2654435761u) % (unsigned)nshards);
+}
+
 // --- Declaraciones `extern` ---
 // Buffer global
 extern TaskBuffer task_buffer;
@@ -83,5 +113,9 @@ extern pthread_mutex_t db_mux;
 extern LogEntry *log_head;
 // Mutex que protege la lista de logs
 extern pthread_mutex_t log_mux;
+// Se señala (con log_mux) cada vez que add_log() publica un registro
+extern pthread_cond_t log_cond;
+// Reservas encoladas, más reciente primero (con log_mux; ver replica.c)
+extern HoldEvent *hold_log;
 
 #endif // COMMON_H
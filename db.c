@@ -5,13 +5,47 @@
 #include <string.h>
 #include <time.h>
 #include <pthread.h>
+#include <limits.h>
+#include <unistd.h>
 #include "db.h"
+#include "loader.h"
 
 TaskBuffer task_buffer;           
 BookNode *db_head = NULL;        
 pthread_mutex_t db_mux = PTHREAD_MUTEX_INITIALIZER;
 LogEntry *log_head = NULL;        
 pthread_mutex_t log_mux = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t log_cond = PTHREAD_COND_INITIALIZER;
+HoldEvent *hold_log = NULL;
+
+// Se incrementa (con db_mux) cada vez que se reemplaza la lista de libros
+static unsigned long catalog_version = 0;
+
+// Serializa los cambios de estructura de la lista (reload_db)
+static pthread_mutex_t reload_mux = PTHREAD_MUTEX_INITIALIZER;
+// Contador de cambios de estado (con db_mux); cada libro guarda en version
+// el valor de su último cambio
+static unsigned long db_changes = 0;
+
+#define MAX_DB_READERS  64
+#define RELOAD_BATCH    256   // Libros mezclados por cada toma de db_mux
+
+// Lectores sin db_mux (ver db_read_begin): cada hilo publica la época en la
+// que entró a su sección, o 0 si está fuera.
+typedef struct {
+    unsigned long epoch;
+    int in_use;
+    char pad[64 - sizeof(unsigned long) - sizeof(int)];
+} ReaderSlot;
+
+static ReaderSlot readers[MAX_DB_READERS];
+static unsigned long db_epoch = 1;
+static __thread ReaderSlot *my_reader = NULL;
+static __thread int reader_overflow = 0;
+static pthread_key_t reader_key;
+static pthread_once_t reader_key_once = PTHREAD_ONCE_INIT;
+// Hilos sin ranura libre: leen con este rwlock y la recarga lo toma en escritura
+static pthread_rwlock_t overflow_lock = PTHREAD_RWLOCK_INITIALIZER;
 
 
 // Función interna que formatea un time_t a string "DD-MM-YYYY"
@@ -20,69 +54,288 @@ static void format_date(time_t t, char out_date[]) {
     strftime(out_date, DATE_STR_LEN, "%d-%m-%Y", tm_info);
 }
 
+static void release_reader(void *arg) {
+    ReaderSlot *r = arg;
+    __atomic_store_n(&r->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void make_reader_key(void) {
+    pthread_key_create(&reader_key, release_reader);
+}
+
+void db_read_begin(void) {
+    if (!my_reader) {
+        pthread_once(&reader_key_once, make_reader_key);
+        for (int i = 0; i < MAX_DB_READERS && !my_reader; i++) {
+            int expected = 0;
+            if (__atomic_compare_exchange_n(&readers[i].in_use, &expected, 1, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                my_reader = &readers[i];
+                pthread_setspecific(reader_key, my_reader);
+            }
+        }
+        if (!my_reader) {
+            reader_overflow = 1;
+            pthread_rwlock_rdlock(&overflow_lock);
+            return;
+        }
+    }
+    // SEQ_CST: o la recarga ve esta época, o este hilo ve el db_head nuevo
+    __atomic_store_n(&my_reader->epoch, __atomic_load_n(&db_epoch, __ATOMIC_SEQ_CST),
+                     __ATOMIC_SEQ_CST);
+}
+
+void db_read_end(void) {
+    if (reader_overflow) {
+        reader_overflow = 0;
+        pthread_rwlock_unlock(&overflow_lock);
+        return;
+    }
+    __atomic_store_n(&my_reader->epoch, 0, __ATOMIC_RELEASE);
+}
+
+// Espera a que todo lector que pudiera tener un nodo de la lista anterior
+// (entró antes de publicarse la nueva) salga de su sección.
+static void db_synchronize(void) {
+    unsigned long e = __atomic_add_fetch(&db_epoch, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < MAX_DB_READERS; i++) {
+        unsigned long r;
+        while ((r = __atomic_load_n(&readers[i].epoch, __ATOMIC_SEQ_CST)) != 0 && r < e) {
+            struct timespec pause = { 0, 1000000L };
+            nanosleep(&pause, NULL);
+        }
+    }
+    pthread_rwlock_wrlock(&overflow_lock);
+    pthread_rwlock_unlock(&overflow_lock);
+}
+
+// Marca un cambio de estado del libro (db_mux tomado)
+static void lend_ejemplar(BookNode *bn, int idx, char out_date[]);
+
+static void touch_book(BookNode *bn) {
+    bn->version = ++db_changes;
+}
+
 // Carga la base de datos desde un archivo de texto.
-void load_db(const char *filename) {
-    FILE *f = fopen(filename, "r");
-    if (!f) {
-        perror("Error al abrir archivo de base de datos");
+// Los errores de formato se informan con su número de línea y se omiten;
+// sólo se aborta si el archivo no se puede abrir.
+void load_db(const char *filename, int threads, int shard, int nshards) {
+    BookNode *head = NULL;
+    int nerrors = parse_catalog_shard(filename, threads, shard, nshards, &head);
+    if (nerrors < 0) {
         exit(1);
     }
-    char line[MAX_LINE_LEN];
-
-    // Lee línea a línea
-    while (fgets(line, sizeof(line), f)) {
-        // Si la línea está vacía o sólo newline, saltar
-        if (strlen(line) <= 1) continue;
+    if (nerrors > 0) {
+        fprintf(stderr, "Advertencia: %d errores al cargar \"%s\"\n", nerrors, filename);
+    }
+    if (!head) return;
 
-        // Crear nuevo nodo para este libro
-        BookNode *bn = malloc(sizeof(BookNode));
-        memset(bn, 0, sizeof(BookNode));
+    // Enlazar la lista cargada (en orden de archivo) delante de la existente
+    BookNode *tail = head;
+    while (tail->next) tail = tail->next;
+    tail->next = db_head;
+    db_head = head;
+}
 
-        // Primera línea del libro: "Título,ISBN,Total"
-        char *tok = strtok(line, ",");
-        strncpy(bn->book.title, tok, MAX_TITLE_LEN);
+// Índice hash ISBN → BookNode de una lista, para la mezcla de recargas
+typedef struct {
+    BookNode **slots;
+    size_t mask;
+} BookIndex;
+
+static void index_build(BookIndex *ix, BookNode *head) {
+    size_t n = 0, cap = 16;
+    for (BookNode *bn = head; bn; bn = bn->next) n++;
+    while (cap < n * 2) cap <<= 1;
+    ix->slots = calloc(cap, sizeof(BookNode *));
+    ix->mask = cap - 1;
+    for (BookNode *bn = head; bn; bn = bn->next) {
+        size_t i = ((unsigned)bn->book.isbn * 2654435761u) & ix->mask;
+        while (ix->slots[i]) i = (i + 1) & ix->mask;
+        ix->slots[i] = bn;
+    }
+}
 
-        tok = strtok(NULL, ",");
-        bn->book.isbn = atoi(tok);
+static BookNode *index_find(const BookIndex *ix, int isbn) {
+    size_t i = ((unsigned)isbn * 2654435761u) & ix->mask;
+    while (ix->slots[i]) {
+        if (ix->slots[i]->book.isbn == isbn) return ix->slots[i];
+        i = (i + 1) & ix->mask;
+    }
+    return NULL;
+}
 
-        tok = strtok(NULL, ",");
-        bn->book.total = atoi(tok);
+// Par libro viejo → libro nuevo de una recarga, con lo que ya se mezcló
+typedef struct {
+    BookNode *ob;          // libro del catálogo en uso
+    BookNode *nb;          // mismo ISBN en el archivo nuevo, o NULL
+    BookNode *copy;        // ob retirado del archivo pero en uso: se conserva
+    int file_total;        // ejemplares de nb según el archivo
+    int kept;              // ejemplares prestados ausentes del archivo
+    unsigned long seen;    // ob->version cuando se mezcló
+} ReloadPair;
+
+// Indica si un libro tiene estado vivo que no se puede descartar
+static int book_in_use(const BookNode *bn) {
+    if (bn->holds_head) return 1;
+    for (int i = 0; i < bn->book.total; i++) {
+        if (bn->book.ejemplares[i].status == 'P') return 1;
+    }
+    return 0;
+}
 
-        // Leer exactamente 'total' líneas siguientes, cada una describe un ejemplar
-        for (int i = 0; i < bn->book.total; i++) {
-            if (!fgets(line, sizeof(line), f)) break;
-            char *t2 = strtok(line, ",");
-            bn->book.ejemplares[i].id = atoi(t2);
-
-            t2 = strtok(NULL, ",");
-            bn->book.ejemplares[i].status = t2[1]; 
-
-            t2 = strtok(NULL, ",");
-            strncpy(bn->book.ejemplares[i].date, t2, DATE_STR_LEN);
-            bn->book.ejemplares[i].date[
-                strcspn(bn->book.ejemplares[i].date, "\r\n")
-            ] = '\0';
+// Traslada al catálogo nuevo el estado de préstamo de p->ob (db_mux
+// tomado). Se puede repetir: nb vuelve primero a su estado del archivo.
+static void merge_pair(ReloadPair *p) {
+    BookNode *ob = p->ob, *nb = p->nb;
+    p->seen = ob->version;
+    if (!nb) {
+        // Libro retirado del archivo pero con préstamos o reservas:
+        // se mantiene una copia para no perder su estado
+        if (book_in_use(ob)) {
+            if (!p->copy) p->copy = malloc(sizeof(BookNode));
+            *p->copy = *ob;
+            p->copy->next = NULL;
+        } else if (p->copy) {
+            free(p->copy);
+            p->copy = NULL;
+        }
+        return;
+    }
+    nb->book.total = p->file_total;
+    p->kept = 0;
+    for (int i = 0; i < ob->book.total; i++) {
+        Ejemplar *oe = &ob->book.ejemplares[i];
+        int found = 0;
+        for (int j = 0; j < p->file_total; j++) {
+            if (nb->book.ejemplares[j].id == oe->id) {
+                nb->book.ejemplares[j].status = oe->status;
+                strncpy(nb->book.ejemplares[j].date, oe->date, DATE_STR_LEN);
+                found = 1;
+                break;
+            }
+        }
+        // Un ejemplar prestado que ya no figura en el archivo se conserva
+        if (!found && oe->status == 'P' && nb->book.total < MAX_EJEMPLARES) {
+            nb->book.ejemplares[nb->book.total++] = *oe;
+            p->kept++;
         }
-
-        // Insertar al inicio de la lista enlazada (orden arbitrario)
-        bn->next = db_head;
-        db_head = bn;
     }
+}
 
-    fclose(f);
+// Presta los ejemplares libres de bn a los primeros de su cola de espera
+// (db_mux tomado), como haría do_devolver(): si no, un préstamo directo se
+// los llevaría antes que a quienes esperan. Los avisos quedan en st->served.
+static void serve_holds(BookNode *bn, ReloadStats *st) {
+    int idx;
+    while (bn->holds_head && (idx = find_available_ejemplar(&bn->book)) >= 0) {
+        HoldEntry *h = bn->holds_head;
+        bn->holds_head = h->next;
+        if (!bn->holds_head) bn->holds_tail = NULL;
+
+        st->served = realloc(st->served, (st->nserved + 1) * sizeof(Task));
+        Task *t = &st->served[st->nserved++];
+        memset(t, 0, sizeof(*t));
+        t->op = OP_RESERVAR;
+        t->isbn = bn->book.isbn;
+        t->ejemplar = bn->book.ejemplares[idx].id;
+        lend_ejemplar(bn, idx, t->date);
+        strncpy(t->reply_fifo, h->reply_fifo, FIFO_NAME_LEN);
+        free(h);
+    }
 }
 
-// Guarda la BD actual de vuelta a un archivo de texto.
-void save_db(const char *filename) {
-    pthread_mutex_lock(&db_mux);
+// Recarga el catálogo desde filename sin detener el servicio. El archivo se
+// analiza y se indexa fuera de db_mux, y el estado de préstamo se traslada
+// por tandas de RELOAD_BATCH libros soltando db_mux entre una y otra. Al
+// final, con db_mux, sólo se rehacen los libros que cambiaron después de su
+// tanda (version distinta), se mueven las colas de espera y se publica la
+// lista nueva con un store atómico de db_head. La lista vieja se libera
+// cuando ya no queda ningún lector que haya podido verla (db_synchronize).
+int reload_db(const char *filename, int threads, int shard, int nshards,
+              ReloadStats *st) {
+    memset(st, 0, sizeof(*st));
+    BookNode *head = NULL;
+    st->errors = parse_catalog_shard(filename, threads, shard, nshards, &head);
+    if (st->errors < 0) {
+        return -1;
+    }
 
-    FILE *f = fopen(filename, "w");
-    if (!f) {
-        perror("Error al abrir archivo de salida de base de datos");
+    BookIndex ix;
+    index_build(&ix, head);
+    BookNode *tail = NULL;
+    for (BookNode *bn = head; bn; bn = bn->next) {
+        tail = bn;
+        st->books++;
+    }
+
+    // Sólo reload_db cambia la estructura de la lista: con reload_mux
+    // tomado la lista vieja se puede recorrer sin db_mux
+    pthread_mutex_lock(&reload_mux);
+    BookNode *old = db_head;
+    size_t nold = 0;
+    for (BookNode *ob = old; ob; ob = ob->next) nold++;
+    ReloadPair *pairs = calloc(nold ? nold : 1, sizeof(ReloadPair));
+    size_t k = 0;
+    for (BookNode *ob = old; ob; ob = ob->next, k++) {
+        pairs[k].ob = ob;
+        pairs[k].nb = index_find(&ix, ob->book.isbn);
+        pairs[k].file_total = pairs[k].nb ? pairs[k].nb->book.total : 0;
+    }
+    free(ix.slots);
+
+    for (size_t i = 0; i < nold; i += RELOAD_BATCH) {
+        pthread_mutex_lock(&db_mux);
+        for (size_t j = i; j < nold && j < i + RELOAD_BATCH; j++) {
+            merge_pair(&pairs[j]);
+        }
         pthread_mutex_unlock(&db_mux);
-        return;
     }
 
+    pthread_mutex_lock(&db_mux);
+    for (size_t i = 0; i < nold; i++) {
+        ReloadPair *p = &pairs[i];
+        if (p->ob->version != p->seen) {
+            merge_pair(p);
+        }
+        BookNode *dst = p->nb ? p->nb : p->copy;
+        if (dst) {
+            dst->version = p->ob->version;
+            dst->holds_head = p->ob->holds_head;
+            dst->holds_tail = p->ob->holds_tail;
+            p->ob->holds_head = p->ob->holds_tail = NULL;
+            serve_holds(dst, st);
+        }
+        if (p->nb) {
+            st->updated++;
+            st->kept += p->kept;
+        } else if (p->copy) {
+            if (tail) tail->next = p->copy;
+            else      head = p->copy;
+            tail = p->copy;
+            st->kept_books++;
+        } else {
+            st->removed++;
+        }
+    }
+    st->added = st->books - st->updated;
+
+    // Publicación atómica: los lectores sin db_mux ven la lista vieja o la
+    // nueva completa, nunca una intermedia
+    __atomic_store_n(&db_head, head, __ATOMIC_SEQ_CST);
+    catalog_version++;
+    pthread_mutex_unlock(&db_mux);
+    pthread_mutex_unlock(&reload_mux);
+
+    free(pairs);
+    db_synchronize();
+    free_catalog(old);
+    return 0;
+}
+
+// Escribe todos los libros en formato de base.txt sin modificar la BD.
+// Devuelve 0 si la escritura fue completa, -1 si hubo error de E/S.
+static int write_books(FILE *f) {
     // Recorre cada nodo/libro en memoria
     for (BookNode *bn = db_head; bn; bn = bn->next) {
         // Escribe línea de cabecera: "Título,ISBN,Total"
@@ -95,23 +348,167 @@ void save_db(const char *filename) {
         for (int i = 0; i < bn->book.total; i++) {
             Ejemplar *e = &bn->book.ejemplares[i];
 
-            // Antes de imprimir, recortamos cualquier '\r' o '\n' sobrante
-            e->date[ strcspn(e->date, "\r\n") ] = '\0';
-
-            fprintf(f, "%d, %c, %s\n",
+            // Ignora cualquier '\r' o '\n' sobrante sin tocar e->date
+            fprintf(f, "%d, %c, %.*s\n",
                     e->id,
                     e->status,
+                    (int)strcspn(e->date, "\r\n"),
                     e->date);
         }
     }
+    return ferror(f) ? -1 : 0;
+}
+
+// Escribe la BD en "<filename>.tmp.<pid>" y la publica con rename() atómico,
+// de modo que un lector nunca vea el archivo a medio escribir.
+static int write_db_atomic(const char *filename) {
+    char tmp[PATH_MAX];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%d", filename, (int)getpid());
+
+    FILE *f = fopen(tmp, "w");
+    if (!f) {
+        perror("Error al abrir archivo de salida de base de datos");
+        return -1;
+    }
+    int rc = write_books(f);
+    if (fflush(f) != 0 || fsync(fileno(f)) != 0) rc = -1;
+    if (fclose(f) != 0) rc = -1;
+    if (rc == 0 && rename(tmp, filename) != 0) {
+        perror("Error al renombrar archivo de base de datos");
+        rc = -1;
+    }
+    if (rc != 0) unlink(tmp);
+    return rc;
+}
+
+// Guarda la BD actual de vuelta a un archivo de texto.
+void save_db(const char *filename) {
+    pthread_mutex_lock(&db_mux);
+    write_db_atomic(filename);
+    pthread_mutex_unlock(&db_mux);
+}
+
+// Toma una instantánea consistente de la BD con fork(): db_mux sólo se
+// retiene mientras se duplica el proceso, y es el hijo (con su copia
+// copy-on-write de la memoria) quien escribe el archivo y hace rename().
+pid_t snapshot_db(const char *filename) {
+    pthread_mutex_lock(&db_mux);
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Hijo: sólo queda este hilo, la BD congelada en el instante del fork
+        _exit(write_db_atomic(filename) == 0 ? 0 : 1);
+    }
+    pthread_mutex_unlock(&db_mux);
+    if (pid < 0) {
+        perror("Error al crear proceso de instantánea");
+    }
+    return pid;
+}
+
+// Reemplaza toda la BD por head (p. ej. la instantánea recibida del
+// primario en una réplica). La lista vieja se libera como en reload_db().
+void install_db(BookNode *head) {
+    pthread_mutex_lock(&reload_mux);
+    pthread_mutex_lock(&db_mux);
+    BookNode *old = db_head;
+    __atomic_store_n(&db_head, head, __ATOMIC_SEQ_CST);
+    catalog_version++;
+    pthread_mutex_unlock(&db_mux);
+    pthread_mutex_unlock(&reload_mux);
+    db_synchronize();
+    free_catalog(old);
+}
 
+// Serializa la BD en memoria en formato base.txt seguida de una línea
+// "H,isbn,fifo" por cada reserva en espera, en el orden de su cola. Con
+// db_mux tomado, y por tanto sin operaciones a medias, también devuelve las
+// cabezas del log y de hold_log y la versión del catálogo: lo posterior a
+// *out_log y *out_holds son justo los cambios que aún no están en el texto.
+char *dump_db(size_t *out_len, size_t *out_catalog_len, LogEntry **out_log,
+              HoldEvent **out_holds, unsigned long *out_version) {
+    char *buf = NULL;
+    FILE *f = open_memstream(&buf, out_len);
+    pthread_mutex_lock(&db_mux);
+    write_books(f);
+    fflush(f);
+    *out_catalog_len = *out_len;
+    for (BookNode *bn = db_head; bn; bn = bn->next) {
+        for (HoldEntry *h = bn->holds_head; h; h = h->next) {
+            fprintf(f, "H,%d,%s\n", bn->book.isbn, h->reply_fifo);
+        }
+    }
+    pthread_mutex_lock(&log_mux);
+    *out_log = log_head;
+    *out_holds = hold_log;
+    pthread_mutex_unlock(&log_mux);
+    *out_version = catalog_version;
+    pthread_mutex_unlock(&db_mux);
     fclose(f);
+    return buf;
+}
+
+unsigned long db_version(void) {
+    return __atomic_load_n(&catalog_version, __ATOMIC_ACQUIRE);
+}
+
+// Aplica un cambio recibido del primario y lo registra en el log local.
+// En el primario una devolución entrega el ejemplar al primero de la cola
+// (el préstamo llega después como otro cambio 'P'), así que aquí una 'D'
+// sobre un libro con reservas saca también al primero de la cola.
+int apply_mutation(char status, int isbn, int ejemplar, const char date[]) {
+    pthread_mutex_lock(&db_mux);
+    BookNode *bn = find_book(isbn);
+    if (!bn) {
+        pthread_mutex_unlock(&db_mux);
+        return -1;
+    }
+    for (int i = 0; i < bn->book.total; i++) {
+        Ejemplar *e = &bn->book.ejemplares[i];
+        if (e->id == ejemplar) {
+            if (status != 'R') e->status = status;
+            strncpy(e->date, date, DATE_STR_LEN);
+            HoldEntry *h = bn->holds_head;
+            if (status == 'D' && h) {
+                bn->holds_head = h->next;
+                if (!bn->holds_head) bn->holds_tail = NULL;
+                free(h);
+            }
+            touch_book(bn);
+            add_log(status, bn->book.title, isbn, ejemplar, date);
+            pthread_mutex_unlock(&db_mux);
+            return 0;
+        }
+    }
+    pthread_mutex_unlock(&db_mux);
+    return -1;
+}
+
+// Encola al final de las reservas de isbn una recibida del primario.
+// Devuelve 0 si se encoló, -1 si el libro no existe.
+int apply_hold(int isbn, const char *reply_fifo) {
+    pthread_mutex_lock(&db_mux);
+    BookNode *bn = find_book(isbn);
+    if (!bn) {
+        pthread_mutex_unlock(&db_mux);
+        return -1;
+    }
+    HoldEntry *h = malloc(sizeof(HoldEntry));
+    strncpy(h->reply_fifo, reply_fifo, FIFO_NAME_LEN - 1);
+    h->reply_fifo[FIFO_NAME_LEN - 1] = '\0';
+    h->next = NULL;
+    if (bn->holds_tail) bn->holds_tail->next = h;
+    else                bn->holds_head = h;
+    bn->holds_tail = h;
+    touch_book(bn);
     pthread_mutex_unlock(&db_mux);
+    return 0;
 }
 
 // Busca un libro por ISBN en la lista enlazada.
 BookNode* find_book(int isbn) {
-    for (BookNode *bn = db_head; bn; bn = bn->next) {
+    // Carga atómica: reload_db() puede publicar una lista nueva en cualquier
+    // momento (SEQ_CST para ordenarla tras la época de db_read_begin)
+    for (BookNode *bn = __atomic_load_n(&db_head, __ATOMIC_SEQ_CST); bn; bn = bn->next) {
         if (bn->book.isbn == isbn) {
             return bn;
         }
@@ -129,6 +526,42 @@ int find_available_ejemplar(Book *b) {
     return -1;
 }
 
+// Cuenta los ejemplares disponibles y totales de un libro (sólo lectura).
+int do_consultar(int isbn, int *out_avail, int *out_total) {
+    pthread_mutex_lock(&db_mux);
+    BookNode *bn = find_book(isbn);
+    if (!bn) {
+        pthread_mutex_unlock(&db_mux);
+        return -1;
+    }
+    int avail = 0;
+    for (int i = 0; i < bn->book.total; i++) {
+        if (bn->book.ejemplares[i].status == 'D') avail++;
+    }
+    *out_avail = avail;
+    *out_total = bn->book.total;
+    pthread_mutex_unlock(&db_mux);
+    return 0;
+}
+
+// Presta el ejemplar idx de bn (db_mux ya tomado): lo marca 'P' con
+// fecha de devolución hoy + 7 días y lo registra en el log.
+static void lend_ejemplar(BookNode *bn, int idx, char out_date[]) {
+    // Calcular fecha de devolución: hoy + 7 días
+    time_t now = time(NULL);
+    time_t future = now + 7 * 24 * 3600;
+    format_date(future, out_date);
+
+    // Actualizar ejemplar: marcar prestado
+    bn->book.ejemplares[idx].status = 'P';
+    strncpy(bn->book.ejemplares[idx].date, out_date, DATE_STR_LEN);
+
+    touch_book(bn);
+
+    // Agregar registro en log
+    add_log('P', bn->book.title, bn->book.isbn, bn->book.ejemplares[idx].id, out_date);
+}
+
 // Realiza el préstamo de un ejemplar de un libro con el ISBN dado.
 int do_prestamo(int isbn, int *out_ejemplar, char out_date[]) {
     pthread_mutex_lock(&db_mux);
@@ -147,20 +580,65 @@ int do_prestamo(int isbn, int *out_ejemplar, char out_date[]) {
         return -1;
     }
 
-    // Calcular fecha de devolución: hoy + 7 días
-    time_t now = time(NULL);
-    time_t future = now + 7 * 24 * 3600;
-    format_date(future, out_date);
-
-    // Actualizar ejemplar: marcar prestado
-    bn->book.ejemplares[idx].status = 'P';
-    strncpy(bn->book.ejemplares[idx].date, out_date, DATE_STR_LEN);
+    lend_ejemplar(bn, idx, out_date);
 
     // Devolver ID de ejemplar al llamador
     *out_ejemplar = bn->book.ejemplares[idx].id;
 
-    // Agregar registro en log
-    add_log('P', bn->book.title, isbn, bn->book.ejemplares[idx].id, out_date);
+    pthread_mutex_unlock(&db_mux);
+    return 0;
+}
+
+// Registra en hold_log una reserva recién encolada para la réplica. Se llama
+// con db_mux tomado, así que queda ordenada con los registros de add_log().
+static void add_hold_event(int isbn, const char *reply_fifo) {
+    HoldEvent *ev = malloc(sizeof(HoldEvent));
+    ev->isbn = isbn;
+    strncpy(ev->reply_fifo, reply_fifo, FIFO_NAME_LEN);
+
+    pthread_mutex_lock(&log_mux);
+    ev->after = log_head;
+    ev->next = hold_log;
+    hold_log = ev;
+    pthread_cond_broadcast(&log_cond);
+    pthread_mutex_unlock(&log_mux);
+}
+
+// Reserva un ejemplar: si hay uno libre y nadie espera, se presta en el acto;
+// si no, el cliente entra al final de la cola de espera del libro.
+int do_reservar(int isbn, const char *reply_fifo, int *out_ejemplar,
+                char out_date[], int *out_pos) {
+    pthread_mutex_lock(&db_mux);
+
+    BookNode *bn = find_book(isbn);
+    if (!bn) {
+        // Libro no existe
+        pthread_mutex_unlock(&db_mux);
+        return -1;
+    }
+    int idx = bn->holds_head ? -1 : find_available_ejemplar(&bn->book);
+    if (idx >= 0) {
+        lend_ejemplar(bn, idx, out_date);
+        *out_ejemplar = bn->book.ejemplares[idx].id;
+        pthread_mutex_unlock(&db_mux);
+        return 1;
+    }
+
+    // Encolar al final y calcular la posición en la cola
+    HoldEntry *h = malloc(sizeof(HoldEntry));
+    strncpy(h->reply_fifo, reply_fifo, FIFO_NAME_LEN);
+    h->next = NULL;
+    int pos = 1;
+    if (bn->holds_tail) {
+        for (HoldEntry *it = bn->holds_head; it; it = it->next) pos++;
+        bn->holds_tail->next = h;
+    } else {
+        bn->holds_head = h;
+    }
+    bn->holds_tail = h;
+    *out_pos = pos;
+    touch_book(bn);
+    add_hold_event(isbn, reply_fifo);
 
     pthread_mutex_unlock(&db_mux);
     return 0;
@@ -187,6 +665,7 @@ int do_renovar(int isbn, int ejemplar, char out_date[]) {
 
             // Actualizar fecha en ejemplar
             strncpy(bn->book.ejemplares[i].date, out_date, DATE_STR_LEN);
+            touch_book(bn);
 
             // Agregar registro de renovación en log
             add_log('R', bn->book.title, isbn, ejemplar, out_date);
@@ -202,8 +681,12 @@ int do_renovar(int isbn, int ejemplar, char out_date[]) {
 }
 
 // Realiza devolución de un ejemplar prestado.
-int do_devolver(int isbn, int ejemplar) {
+// Si hay clientes en espera, el ejemplar se presta directamente al primero
+// de la cola: se devuelve su HoldEntry en *out_hold (el llamador lo libera
+// tras avisarle) y la fecha de devolución en out_date.
+int do_devolver(int isbn, int ejemplar, HoldEntry **out_hold, char out_date[]) {
     pthread_mutex_lock(&db_mux);
+    *out_hold = NULL;
 
     BookNode *bn = find_book(isbn);
     if (!bn) {
@@ -222,10 +705,20 @@ int do_devolver(int isbn, int ejemplar) {
             char today[DATE_STR_LEN];
             format_date(now, today);
             strncpy(bn->book.ejemplares[i].date, today, DATE_STR_LEN);
+            touch_book(bn);
 
             // Agregar registro de devolución en log
             add_log('D', bn->book.title, isbn, ejemplar, today);
 
+            // Entregar el ejemplar al primer cliente en espera
+            HoldEntry *h = bn->holds_head;
+            if (h) {
+                bn->holds_head = h->next;
+                if (!bn->holds_head) bn->holds_tail = NULL;
+                lend_ejemplar(bn, i, out_date);
+                *out_hold = h;
+            }
+
             pthread_mutex_unlock(&db_mux);
             return 0;
         }
@@ -246,18 +739,24 @@ void add_log(char status, const char *title, int isbn, int ejemplar, const char
     n->isbn = isbn;
     n->ejemplar = ejemplar;
     strncpy(n->date, date, DATE_STR_LEN);
+    format_date(time(NULL), n->op_date);
 
     // Proteger con mutex mientras modificamos la lista
     pthread_mutex_lock(&log_mux);
     n->next = log_head;
     log_head = n;
+    pthread_cond_broadcast(&log_cond);
     pthread_mutex_unlock(&log_mux);
 }
 
 // Imprime por pantalla todos los registros de la lista de logs.
+// Los nodos publicados no cambian, así que log_mux sólo protege la lectura
+// de la cabeza y no se retiene mientras se imprime.
 void print_report() {
     pthread_mutex_lock(&log_mux);
-    for (LogEntry *le = log_head; le; le = le->next) {
+    LogEntry *head = log_head;
+    pthread_mutex_unlock(&log_mux);
+    for (LogEntry *le = head; le; le = le->next) {
         printf("%c, %s, %d, %d, %s\n",
                le->status,
                le->title,
@@ -265,5 +764,4 @@ void print_report() {
                le->ejemplar,
                le->date);
     }
-    pthread_mutex_unlock(&log_mux);
 }
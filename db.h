@@ -1,30 +1,103 @@
 #ifndef DB_H
 #define DB_H
 
+#include <sys/types.h>
 #include "common.h"
 
-// Carga el archivo de texto que tenemos como bden memoria.
-void load_db(const char *filename);
+// Carga el archivo de texto que tenemos como bd en memoria.
+// threads > 1 analiza fragmentos del archivo en paralelo (ver loader.h).
+// Con nshards > 1 sólo se cargan los libros del fragmento shard.
+void load_db(const char *filename, int threads, int shard, int nshards);
+
+// Resultado de una recarga en caliente del catálogo
+typedef struct {
+    int errors;       // errores de formato en el archivo nuevo
+    int books;        // libros leídos del archivo nuevo
+    int updated;      // libros que ya existían (conservan préstamos y reservas)
+    int added;        // libros nuevos
+    int removed;      // libros sin préstamos que ya no figuran en el archivo
+    int kept_books;   // libros ausentes del archivo que se conservan por estar en uso
+    int kept;         // ejemplares prestados ausentes del archivo que se conservan
+    Task *served;     // OP_RESERVAR para avisar a quienes recibieron un ejemplar
+    int nserved;      // nuevo (el llamador encola los avisos y libera served)
+} ReloadStats;
+
+// Recarga el catálogo desde filename sin reiniciar el receptor, conservando
+// el estado de préstamo de los ejemplares existentes y las colas de espera.
+// Los ejemplares libres de un libro con cola se prestan a los primeros de la
+// cola, igual que en una devolución (ver st->served).
+// shard/nshards: sólo se cargan los libros de ese fragmento (nshards <= 1: todo).
+// Devuelve 0 si se publicó el catálogo nuevo, -1 si no se pudo leer.
+int reload_db(const char *filename, int threads, int shard, int nshards,
+              ReloadStats *st);
+
+// Reemplaza la BD completa por la lista head (publicación atómica)
+void install_db(BookNode *head);
+
+// Serializa la BD en formato base.txt en un búfer nuevo (a liberar con
+// free), seguida de una línea "H,isbn,fifo" por reserva en espera; los
+// primeros *out_catalog_len bytes son el catálogo. En *out_log y *out_holds
+// devuelve las cabezas del log y de hold_log en ese mismo instante y en
+// *out_version la versión del catálogo, que cambia con cada recarga.
+char *dump_db(size_t *out_len, size_t *out_catalog_len, LogEntry **out_log,
+              HoldEvent **out_holds, unsigned long *out_version);
+
+// Versión actual del catálogo (ver dump_db)
+unsigned long db_version(void);
+
+// Aplica en esta BD un cambio 'P', 'R' o 'D' ocurrido en otro receptor
+// (replicación). Devuelve 0 si se aplicó, -1 si el libro o ejemplar no existe.
+int apply_mutation(char status, int isbn, int ejemplar, const char date[]);
+
+// Encola una reserva hecha en otro receptor (replicación).
+// Devuelve 0 si se encoló, -1 si el libro no existe.
+int apply_hold(int isbn, const char *reply_fifo);
 
 // Guarda el contenido actual de la BD en el archivo de texto.
 // Se utiliza al finalizar el servicio.
 void save_db(const char *filename);
 
+// Lanza en segundo plano un proceso hijo que escribe una instantánea
+// consistente de la BD en filename (vía archivo temporal + rename).
+// Devuelve el pid del hijo, que el llamador debe recoger con waitpid(),
+// o -1 si no se pudo crear.
+pid_t snapshot_db(const char *filename);
+
 // Busca un libro en la lista enlazada por su ISBN.
 // Devuelve puntero al nodo BookNode si lo encuentra, o NULL si no.
+// Sin db_mux, el nodo sólo se puede usar dentro de db_read_begin/end.
 BookNode* find_book(int isbn);
 
+// Sección de lectura sin db_mux: los nodos obtenidos con find_book() no se
+// liberan hasta que el hilo llama a db_read_end(), aunque una recarga
+// publique entretanto otro catálogo. No se deben anidar.
+void db_read_begin(void);
+void db_read_end(void);
+
 // Busca un ejemplar disponible ('D') dentro de un Book.
 int find_available_ejemplar(Book *b);
 
+// Consulta de disponibilidad: ejemplares 'D' y total del libro.
+// Devuelve 0, o -1 si el libro no existe.
+int do_consultar(int isbn, int *out_avail, int *out_total);
+
 // Realiza la operación de préstamo haciendo las validaciones
 int do_prestamo(int isbn, int *out_ejemplar, char out_date[]);
 
 // Realiza la operación de renovación de un ejemplar específico con las verificaciones
 int do_renovar(int isbn, int ejemplar, char out_date[]);
 
-// Realiza la devolución de un ejemplar con las verificaciones
-int do_devolver(int isbn, int ejemplar);
+// Realiza la devolución de un ejemplar con las verificaciones.
+// Si había clientes en espera, el ejemplar queda prestado al primero:
+// *out_hold recibe su entrada (a liberar por el llamador) y out_date la
+// nueva fecha de devolución; si no, *out_hold queda en NULL.
+int do_devolver(int isbn, int ejemplar, HoldEntry **out_hold, char out_date[]);
+
+// Reserva un ejemplar para el cliente con FIFO de respuesta reply_fifo.
+// Devuelve 1 si se prestó en el acto (out_ejemplar/out_date), 0 si quedó en
+// la cola de espera en la posición *out_pos, o -1 si el libro no existe.
+int do_reservar(int isbn, const char *reply_fifo, int *out_ejemplar,
+                char out_date[], int *out_pos);
 
 
 // Agregamos registros al log con status: 'P', 'R' o 'D'; title: título del libro; isbn: ISBN; ejemplar: número; date: fecha operación.
@@ -0,0 +1,297 @@
+// enrutador.c
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <getopt.h>
+#include "common.h"
+
+#define MAX_SHARDS  64
+
+// Receptor hijo que atiende un fragmento del catálogo
+typedef struct {
+    pid_t pid;
+    int console_fd;                 // extremo de escritura de su stdin
+    int fifo_fd;                    // su FIFO de peticiones
+    char fifo[FIFO_NAME_LEN];
+} Shard;
+
+static char fifo_name[FIFO_NAME_LEN];
+static Shard shards[MAX_SHARDS];
+static int nshards = 0;
+static int verbose = 0;
+static volatile int keep_running = 1;
+static int pub_fd = -1;
+static int reply_fd = -1;
+
+/*
+ * Lanza el receptor del fragmento i fijado al núcleo i % ncpu, con su stdin
+ * conectado a una tubería para reenviarle los comandos de consola.
+ */
+static void spawn_shard(int i, const char* receptor_path, const char* db_file,
+                        const char* out_prefix, int load_threads) {
+    Shard* sh = &shards[i];
+    if (snprintf(sh->fifo, sizeof(sh->fifo), "%s.s%d", fifo_name, i) >= (int)sizeof(sh->fifo)) {
+        fprintf(stderr, "Error: nombre de pipe demasiado largo.\n");
+        exit(1);
+    }
+    /* Crear el FIFO antes del hijo para poder abrirlo sin carreras */
+    mkfifo(sh->fifo, 0666);
+
+    int console[2];
+    if (pipe(console) != 0) {
+        perror("Error al crear la tubería de consola");
+        exit(1);
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("Error al crear el receptor del fragmento");
+        exit(1);
+    }
+    if (pid == 0) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        if (ncpu > 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(i % ncpu, &set);
+            sched_setaffinity(0, sizeof(set), &set);
+        }
+        dup2(console[0], STDIN_FILENO);
+        close(console[0]);
+        close(console[1]);
+
+        char shard_arg[32], out_arg[PATH_MAX], jobs_arg[16];
+        snprintf(shard_arg, sizeof(shard_arg), "%d/%d", i, nshards);
+        snprintf(jobs_arg, sizeof(jobs_arg), "%d", load_threads);
+        char* args[16];
+        int n = 0;
+        args[n++] = (char*)receptor_path;
+        args[n++] = "-p"; args[n++] = sh->fifo;
+        args[n++] = "-f"; args[n++] = (char*)db_file;
+        args[n++] = "-k"; args[n++] = shard_arg;
+        args[n++] = "-j"; args[n++] = jobs_arg;
+        args[n++] = "-a"; args[n++] = fifo_name;
+        if (out_prefix[0]) {
+            snprintf(out_arg, sizeof(out_arg), "%s.%d", out_prefix, i);
+            args[n++] = "-s"; args[n++] = out_arg;
+        }
+        if (verbose) args[n++] = "-v";
+        args[n] = NULL;
+        execv(receptor_path, args);
+        perror("Error al ejecutar el receptor");
+        _exit(1);
+    }
+
+    close(console[0]);
+    sh->pid = pid;
+    sh->console_fd = console[1];
+    sh->fifo_fd = open(sh->fifo, O_RDWR);
+    if (sh->fifo_fd < 0) {
+        perror("Error al abrir el FIFO del fragmento");
+        exit(1);
+    }
+}
+
+/*
+ * Mismo criterio que el receptor: sólo se aceptan FIFOs de respuesta
+ * “<pipe>.<algo>” sin más '/', y sólo se escribe si de verdad es un FIFO.
+ */
+static int reply_fifo_allowed(const char* path) {
+    size_t plen = strlen(fifo_name);
+    return strncmp(path, fifo_name, plen) == 0 && path[plen] == '.' &&
+           path[plen + 1] && !strchr(path + plen + 1, '/');
+}
+
+static void write_client_fifo(const char* path, const char* msg) {
+    int cfd = open(path, O_WRONLY | O_NONBLOCK | O_NOCTTY);
+    if (cfd < 0) {
+        return;
+    }
+    struct stat sb;
+    if (fstat(cfd, &sb) == 0 && S_ISFIFO(sb.st_mode)) {
+        write(cfd, msg, strlen(msg));
+    }
+    close(cfd);
+}
+
+/*
+ * Reenvía una línea “Op,Título,ISBN,FIFOrespuesta” al fragmento de su ISBN.
+ * El receptor del fragmento responde directamente al FIFO del cliente, así
+ * que el enrutador no toca las respuestas.
+ */
+static void route_line(char* line) {
+    line[strcspn(line, "\r")] = '\0';
+    if (!line[0] || strncmp(line, "OK,", 3) == 0 ||
+        strncmp(line, "FAIL,", 5) == 0 || strncmp(line, "BYE", 3) == 0) {
+        return;
+    }
+
+    /* Localizar ISBN (tercer campo) y FIFO de respuesta (cuarto campo) */
+    char* c1 = strchr(line, ',');
+    char* c2 = c1 ? strchr(c1 + 1, ',') : NULL;
+    char* c3 = c2 ? strchr(c2 + 1, ',') : NULL;
+    int isbn = c2 ? atoi(c2 + 1) : 0;
+    char op = line[0];
+    if (op >= 'a' && op <= 'z') op -= 32;
+
+    char reply[FIFO_NAME_LEN] = {0};
+    if (c3) {
+        char* r = c3 + 1;
+        while (*r == ' ') r++;
+        strncpy(reply, r, sizeof(reply) - 1);
+        if (!reply_fifo_allowed(reply)) {
+            fprintf(stderr, "Petición descartada: FIFO de respuesta no válido \"%s\"\n", reply);
+            return;
+        }
+    }
+    if (!reply[0] || op == 'M') {
+        /* Sin FIFO propio no hay dónde responder desde el fragmento, y la
+           memoria compartida ataría al cliente a un único fragmento. El
+           rechazo sin FIFO propio va al FIFO público, como en el receptor
+           (al releerlo, las líneas FAIL se ignoran) */
+        char resp[MAX_LINE_LEN];
+        snprintf(resp, sizeof(resp), op == 'M' ? "FAIL,Memoria,0\n" : "FAIL,SinCanal,%d\n", isbn);
+        if (reply[0]) {
+            write_client_fifo(reply, resp);
+        } else {
+            write(reply_fd, resp, strlen(resp));
+        }
+        return;
+    }
+
+    int s = isbn_shard(isbn, nshards);
+    char msg[MAX_LINE_LEN + 2];
+    int len = snprintf(msg, sizeof(msg), "%s\n", line);
+    write(shards[s].fifo_fd, msg, len);
+    if (verbose) {
+        printf("Enrutada operación [%c] ISBN %d → fragmento %d\n", op, isbn, s);
+    }
+}
+
+/*
+ * Hilo de consola: cada línea escrita en el enrutador ('r', 'q …', 'c', 's')
+ * se reenvía a todos los fragmentos. 's' además detiene el enrutador.
+ */
+static void* console_thread(void* arg) {
+    char line[MAX_LINE_LEN];
+    int stopped = 0;
+    while (!stopped && fgets(line, sizeof(line), stdin)) {
+        for (int i = 0; i < nshards; i++) {
+            write(shards[i].console_fd, line, strlen(line));
+        }
+        stopped = (line[0] == 's');
+    }
+    /* Sin consola (EOF): cerrar igualmente todos los fragmentos */
+    for (int i = 0; !stopped && i < nshards; i++) {
+        write(shards[i].console_fd, "s\n", 2);
+    }
+    keep_running = 0;
+    write(pub_fd, "\n", 1);   /* despertar al bucle principal */
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    char db_file[PATH_MAX] = {0};
+    char out_prefix[PATH_MAX] = {0};
+    char receptor_path[PATH_MAX] = "./receptor";
+    int load_threads = 1;
+
+    /*
+     * Parsear opciones:
+     *   -p <fifo>   → FIFO público (mismo protocolo que el receptor)
+     *   -f <file>   → archivo de BD que se reparte entre los fragmentos
+     *   -n <N>      → número de fragmentos (receptores hijos)
+     *   -s <pref>   → cada fragmento guarda su BD en <pref>.<i> al cerrar
+     *   -r <ruta>   → ejecutable del receptor (por defecto ./receptor)
+     *   -j <n>      → hilos de carga de cada fragmento
+     *   -v          → modo verbose
+     */
+    while ((opt = getopt(argc, argv, "p:f:n:s:r:j:v")) != -1) {
+        switch (opt) {
+            case 'p': strncpy(fifo_name, optarg, FIFO_NAME_LEN - 1); break;
+            case 'f': strncpy(db_file, optarg, sizeof(db_file) - 1); break;
+            case 'n': nshards = atoi(optarg); break;
+            case 's': strncpy(out_prefix, optarg, sizeof(out_prefix) - 1); break;
+            case 'r': strncpy(receptor_path, optarg, sizeof(receptor_path) - 1); break;
+            case 'j': load_threads = atoi(optarg); break;
+            case 'v': verbose = 1; break;
+            default:
+                fprintf(stderr,
+                        "Uso: %s -p pipeReceptor -f filedatos -n fragmentos"
+                        " [-s prefijoSalida] [-r rutaReceptor] [-j hilosCarga] [-v]\n",
+                        argv[0]);
+                exit(1);
+        }
+    }
+    if (!fifo_name[0] || !db_file[0] || nshards < 1 || nshards > MAX_SHARDS) {
+        fprintf(stderr, "Error: faltan parámetros obligatorios o -n fuera de 1..%d.\n",
+                MAX_SHARDS);
+        exit(1);
+    }
+    /* Un fragmento caído no debe matar al enrutador al escribirle */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* 1) Lanzar los fragmentos */
+    for (int i = 0; i < nshards; i++) {
+        spawn_shard(i, receptor_path, db_file, out_prefix, load_threads);
+    }
+
+    /* 2) Abrir el FIFO público y atender la consola */
+    mkfifo(fifo_name, 0666);
+    pub_fd = open(fifo_name, O_RDWR);
+    if (pub_fd < 0) {
+        perror("Error al abrir el FIFO");
+        exit(1);
+    }
+    /* Sólo este proceso lee el FIFO público: escribir en él bloqueando
+       podría dejarlo esperándose a sí mismo, así que si no cabe se descarta */
+    reply_fd = open(fifo_name, O_WRONLY | O_NONBLOCK);
+    pthread_t ctid;
+    pthread_create(&ctid, NULL, console_thread, NULL);
+
+    /* 3) Bucle principal: leer peticiones y reenviarlas por ISBN. Una
+       lectura puede cortar la última línea: se guarda para la siguiente */
+    char buf[2 * PIPE_BUF + 1];
+    size_t kept = 0;
+    while (keep_running) {
+        ssize_t n = read(pub_fd, buf + kept, sizeof(buf) - 1 - kept);
+        if (n <= 0) {
+            continue;
+        }
+        size_t len = kept + n;
+        buf[len] = '\0';
+        char* line = buf;
+        for (char* nl; keep_running && (nl = strchr(line, '\n')); line = nl + 1) {
+            *nl = '\0';
+            route_line(line);
+        }
+        kept = buf + len - line;
+        if (kept == sizeof(buf) - 1) {
+            kept = 0;  /* línea sin '\n' más larga que el búfer: descartar */
+        }
+        memmove(buf, line, kept);
+    }
+
+    /* 4) Esperar a que todos los fragmentos guarden y terminen */
+    pthread_join(ctid, NULL);
+    for (int i = 0; i < nshards; i++) {
+        waitpid(shards[i].pid, NULL, 0);
+        close(shards[i].console_fd);
+        close(shards[i].fifo_fd);
+    }
+    close(reply_fd);
+    close(pub_fd);
+    unlink(fifo_name);
+    return 0;
+}
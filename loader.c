@@ -0,0 +1,410 @@
+// loader.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "loader.h"
+
+#define LOAD_CHUNK        (1 << 20)   // Tamaño de bloque de lectura / fragmento mínimo
+#define MAX_LOAD_ERRORS   20          // Errores detallados que se guardan por fragmento
+#define MAX_LOAD_THREADS  16
+
+// Error de carga con la línea (relativa al fragmento) donde ocurrió
+typedef struct {
+    long line;
+    char msg[96];
+} LoadError;
+
+// Estado del analizador de líneas; hay uno por fragmento en modo paralelo
+typedef struct {
+    BookNode *head, *tail;     // libros ya completos, en orden de archivo
+    BookNode *cur;             // libro cuyos ejemplares se están leyendo
+    long cur_line;             // línea de la cabecera de cur
+    int pending;               // ejemplares anunciados que faltan por leer
+    int skipping;              // el libro en curso es de otro fragmento
+    int shard, nshards;        // sólo se cargan los ISBN de este fragmento
+    long lineno;               // líneas procesadas (incluye las vacías)
+    int nerrors;
+    LoadError errors[MAX_LOAD_ERRORS];
+} ParseState;
+
+// Fragmento del archivo mapeado que analiza un hilo
+typedef struct {
+    const char *begin, *end;
+    ParseState st;
+} Shard;
+
+static void add_error(ParseState *st, long line, const char *fmt, ...) {
+    if (st->nerrors < MAX_LOAD_ERRORS) {
+        LoadError *e = &st->errors[st->nerrors];
+        e->line = line;
+        va_list ap;
+        va_start(ap, fmt);
+        vsnprintf(e->msg, sizeof(e->msg), fmt, ap);
+        va_end(ap);
+    }
+    st->nerrors++;
+}
+
+static const char *skip_spaces(const char *p, const char *end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+// Lee un entero no negativo de [p, end); devuelve el puntero tras los dígitos
+// o NULL si no hay dígitos o el número no cabe en un int.
+static const char *parse_uint(const char *p, const char *end, int *out) {
+    long v = 0;
+    const char *start = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p - '0');
+        if (v > 0x7fffffffL) return NULL;
+        p++;
+    }
+    if (p == start) return NULL;
+    *out = (int)v;
+    return p;
+}
+
+// Una línea de ejemplar tiene la forma "id, E, fecha": número y, como
+// segundo campo, un único carácter no numérico. Así se distingue de una
+// cabecera "Título,ISBN,Total" sin depender del contador del libro.
+static int is_copy_line(const char *p, const char *end) {
+    int id;
+    p = skip_spaces(p, end);
+    if (!(p = parse_uint(p, end, &id))) return 0;
+    p = skip_spaces(p, end);
+    if (p == end || *p++ != ',') return 0;
+    p = skip_spaces(p, end);
+    if (p == end || (*p >= '0' && *p <= '9') || *p == ',') return 0;
+    p = skip_spaces(p + 1, end);
+    return p == end || *p == ',';
+}
+
+// Cierra el libro en curso y lo agrega al final de la lista del estado
+static void finish_book(ParseState *st) {
+    if (!st->cur) {
+        st->pending = 0;       // libro de otro fragmento o cabecera inválida
+        st->skipping = 0;
+        return;
+    }
+    if (st->pending > 0) {
+        add_error(st, st->cur_line, "faltan %d ejemplares del ISBN %d", st->pending, st->cur->book.isbn);
+    }
+    st->cur->next = NULL;
+    if (st->tail) st->tail->next = st->cur;
+    else          st->head = st->cur;
+    st->tail = st->cur;
+    st->cur = NULL;
+    st->pending = 0;
+}
+
+// Cabecera "Título,ISBN,Total": se analiza desde la derecha para que el
+// título pueda contener comas.
+static void parse_header(ParseState *st, const char *p, const char *end) {
+    st->skipping = 0;          // cada cabecera decide de nuevo de quién es
+    const char *c2 = end;
+    while (c2 > p && c2[-1] != ',') c2--;
+    const char *c1 = c2 > p ? c2 - 1 : p;
+    while (c1 > p && c1[-1] != ',') c1--;
+    if (c2 == p || c1 == p) {
+        add_error(st, st->lineno, "cabecera inválida, se esperaba \"Título,ISBN,Total\"");
+        return;
+    }
+
+    int isbn, total;
+    const char *q = skip_spaces(c1, c2 - 1);
+    if (!(q = parse_uint(q, c2 - 1, &isbn)) || skip_spaces(q, c2 - 1) != c2 - 1 || isbn == 0) {
+        add_error(st, st->lineno, "ISBN inválido");
+        return;
+    }
+    q = skip_spaces(c2, end);
+    if (!(q = parse_uint(q, end, &total)) || skip_spaces(q, end) != end) {
+        add_error(st, st->lineno, "total de ejemplares inválido (ISBN %d)", isbn);
+        return;
+    }
+    if (st->nshards > 1 && isbn_shard(isbn, st->nshards) != st->shard) {
+        // Libro de otro fragmento: se saltan sus ejemplares sin reservar
+        // memoria (sin ejemplares no queda nada que saltar)
+        st->skipping = total > 0;
+        st->pending = total;
+        return;
+    }
+
+    size_t title_len = (size_t)(c1 - 1 - p);
+    if (title_len == 0) {
+        add_error(st, st->lineno, "título vacío (ISBN %d)", isbn);
+        return;
+    }
+    if (title_len >= MAX_TITLE_LEN) {
+        add_error(st, st->lineno, "título de %zu bytes truncado a %d (ISBN %d)",
+                  title_len, MAX_TITLE_LEN - 1, isbn);
+        title_len = MAX_TITLE_LEN - 1;
+    }
+    if (total > MAX_EJEMPLARES) {
+        add_error(st, st->lineno, "%d ejemplares superan el máximo de %d (ISBN %d); se ignoran los sobrantes",
+                  total, MAX_EJEMPLARES, isbn);
+    }
+
+    BookNode *bn = calloc(1, sizeof(BookNode));
+    memcpy(bn->book.title, p, title_len);
+    bn->book.isbn = isbn;
+    st->cur = bn;
+    st->cur_line = st->lineno;
+    st->pending = total;
+    if (total == 0) finish_book(st);
+}
+
+// Ejemplar "id, E, DD-MM-YYYY" del libro en curso
+static void parse_copy(ParseState *st, const char *p, const char *end) {
+    Book *b = &st->cur->book;
+    int id;
+    p = parse_uint(skip_spaces(p, end), end, &id);
+    p = skip_spaces(p, end) + 1;               // salta la coma
+    p = skip_spaces(p, end);
+    char status = *p++;
+    p = skip_spaces(p, end);
+
+    const char *date = p < end ? skip_spaces(p + 1, end) : end;
+    const char *date_end = end;
+    while (date_end > date && (date_end[-1] == ' ' || date_end[-1] == '\t')) date_end--;
+
+    if (status != 'P' && status != 'D') {
+        add_error(st, st->lineno, "estado '%c' inválido en ejemplar %d del ISBN %d", status, id, b->isbn);
+        return;
+    }
+    int ok = (date_end - date == DATE_STR_LEN - 1);
+    for (int i = 0; ok && i < DATE_STR_LEN - 1; i++) {
+        ok = (i == 2 || i == 5) ? date[i] == '-' : (date[i] >= '0' && date[i] <= '9');
+    }
+    if (!ok) {
+        add_error(st, st->lineno, "fecha inválida en ejemplar %d del ISBN %d (se espera DD-MM-YYYY)", id, b->isbn);
+        return;
+    }
+    if (b->total >= MAX_EJEMPLARES) return;     // ya informado en la cabecera
+
+    Ejemplar *e = &b->ejemplares[b->total++];
+    e->id = id;
+    e->status = status;
+    memcpy(e->date, date, DATE_STR_LEN - 1);
+    e->date[DATE_STR_LEN - 1] = '\0';
+}
+
+// Procesa una línea sin '\n' (no se modifica: puede venir de un mmap)
+static void parse_line(ParseState *st, const char *p, size_t len) {
+    const char *end = p + len;
+    st->lineno++;
+    while (end > p && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) end--;
+    if (skip_spaces(p, end) == end) return;    // línea vacía
+
+    int copy = is_copy_line(p, end);
+    if (st->pending > 0) {
+        if (copy) {
+            if (!st->skipping) parse_copy(st, p, end);
+            if (--st->pending == 0) finish_book(st);
+            return;
+        }
+        finish_book(st);                        // informa los ejemplares que faltan
+    }
+    if (copy) {
+        add_error(st, st->lineno, "ejemplar sin libro (sobra respecto al total de la cabecera)");
+        return;
+    }
+    parse_header(st, p, end);
+}
+
+static void parse_region(ParseState *st, const char *p, const char *end) {
+    while (p < end) {
+        const char *nl = memchr(p, '\n', end - p);
+        size_t len = nl ? (size_t)(nl - p) : (size_t)(end - p);
+        parse_line(st, p, len);
+        p += len + (nl ? 1 : 0);
+    }
+}
+
+// Lectura secuencial en bloques grandes; las líneas que cruzan el final de
+// un bloque se arrastran al siguiente y el búfer crece si una sola línea
+// no cabe.
+static void parse_stream(int fd, ParseState *st) {
+    size_t cap = LOAD_CHUNK, used = 0;
+    char *buf = malloc(cap);
+
+    while (1) {
+        if (used == cap) {
+            cap *= 2;
+            buf = realloc(buf, cap);
+        }
+        ssize_t n = read(fd, buf + used, cap - used);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("Error al leer archivo de base de datos");
+            break;
+        }
+        if (n == 0) break;
+        used += n;
+
+        char *start = buf, *end = buf + used, *nl;
+        while ((nl = memchr(start, '\n', end - start))) {
+            parse_line(st, start, nl - start);
+            start = nl + 1;
+        }
+        used = end - start;
+        memmove(buf, start, used);
+    }
+    if (used > 0) parse_line(st, buf, used);    // última línea sin '\n'
+    free(buf);
+}
+
+static void *shard_thread(void *arg) {
+    Shard *sh = arg;
+    parse_region(&sh->st, sh->begin, sh->end);
+    finish_book(&sh->st);
+    return NULL;
+}
+
+// Avanza desde pos hasta el inicio de la siguiente cabecera de libro
+static const char *next_book_start(const char *pos, const char *begin, const char *end) {
+    if (pos > begin && pos[-1] != '\n') {
+        const char *nl = memchr(pos, '\n', end - pos);
+        if (!nl) return end;
+        pos = nl + 1;
+    }
+    while (pos < end) {
+        const char *nl = memchr(pos, '\n', end - pos);
+        const char *le = nl ? nl : end;
+        const char *t = le;
+        while (t > pos && (t[-1] == '\r' || t[-1] == ' ' || t[-1] == '\t')) t--;
+        if (skip_spaces(pos, t) != t && !is_copy_line(pos, t)) return pos;
+        if (!nl) return end;
+        pos = nl + 1;
+    }
+    return end;
+}
+
+static void report_errors(const char *filename, ParseState *st, long base) {
+    int shown = st->nerrors < MAX_LOAD_ERRORS ? st->nerrors : MAX_LOAD_ERRORS;
+    for (int i = 0; i < shown; i++) {
+        fprintf(stderr, "%s:%ld: %s\n", filename, base + st->errors[i].line, st->errors[i].msg);
+    }
+    if (st->nerrors > shown) {
+        fprintf(stderr, "%s: ... y %d errores más cerca de la línea %ld\n",
+                filename, st->nerrors - shown, base + st->errors[shown - 1].line);
+    }
+}
+
+int parse_catalog(const char *filename, int threads, BookNode **out_head) {
+    return parse_catalog_shard(filename, threads, 0, 1, out_head);
+}
+
+int parse_catalog_shard(const char *filename, int threads, int shard, int nshards,
+                        BookNode **out_head) {
+    *out_head = NULL;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Error al abrir archivo de base de datos");
+        return -1;
+    }
+
+    struct stat sb;
+    if (threads <= 1 || fstat(fd, &sb) != 0 || sb.st_size < 2 * LOAD_CHUNK) {
+        ParseState *st = calloc(1, sizeof(ParseState));
+        st->shard = shard;
+        st->nshards = nshards;
+        parse_stream(fd, st);
+        finish_book(st);
+        close(fd);
+        report_errors(filename, st, 0);
+        int nerrors = st->nerrors;
+        *out_head = st->head;
+        free(st);
+        return nerrors;
+    }
+
+    size_t size = sb.st_size;
+    const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        perror("Error al mapear archivo de base de datos");
+        return -1;
+    }
+    madvise((void *)data, size, MADV_SEQUENTIAL);
+
+    if (threads > MAX_LOAD_THREADS) threads = MAX_LOAD_THREADS;
+    if ((size_t)threads > size / LOAD_CHUNK) threads = size / LOAD_CHUNK;
+
+    // Cortar el archivo en fragmentos que empiecen en una cabecera de libro
+    Shard *shards = calloc(threads, sizeof(Shard));
+    const char *end = data + size;
+    const char *prev = data;
+    for (int i = 0; i < threads; i++) {
+        shards[i].st.shard = shard;
+        shards[i].st.nshards = nshards;
+        shards[i].begin = prev;
+        if (i == threads - 1) {
+            shards[i].end = end;
+        } else {
+            const char *target = data + size / threads * (i + 1);
+            shards[i].end = next_book_start(target > prev ? target : prev, data, end);
+        }
+        prev = shards[i].end;
+    }
+
+    pthread_t *tids = calloc(threads, sizeof(pthread_t));
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tids[i], NULL, shard_thread, &shards[i]);
+    }
+
+    // Unir las listas en orden y traducir líneas relativas a absolutas
+    BookNode *head = NULL, *tail = NULL;
+    long base = 0;
+    int nerrors = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+        ParseState *st = &shards[i].st;
+        report_errors(filename, st, base);
+        nerrors += st->nerrors;
+        base += st->lineno;
+        if (st->head) {
+            if (tail) tail->next = st->head;
+            else      head = st->head;
+            tail = st->tail;
+        }
+    }
+
+    free(tids);
+    free(shards);
+    munmap((void *)data, size);
+    *out_head = head;
+    return nerrors;
+}
+
+int parse_catalog_mem(const char *name, const char *buf, size_t len, BookNode **out_head) {
+    ParseState *st = calloc(1, sizeof(ParseState));
+    parse_region(st, buf, buf + len);
+    finish_book(st);
+    report_errors(name, st, 0);
+    int nerrors = st->nerrors;
+    *out_head = st->head;
+    free(st);
+    return nerrors;
+}
+
+void free_catalog(BookNode *head) {
+    while (head) {
+        BookNode *next = head->next;
+        while (head->holds_head) {
+            HoldEntry *h = head->holds_head;
+            head->holds_head = h->next;
+            free(h);
+        }
+        free(head);
+        head = next;
+    }
+}
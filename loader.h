@@ -0,0 +1,28 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include "common.h"
+
+// Lee un catálogo en formato base.txt y construye una lista de libros en el
+// orden del archivo, sin tocar db_head.
+// threads <= 1: lectura secuencial por bloques grandes con read().
+// threads  > 1: mapea el archivo y analiza fragmentos en paralelo.
+// Los errores se informan por stderr como "archivo:línea: mensaje"; las
+// entradas inválidas se descartan y el resto del catálogo se carga igual.
+// Devuelve el número de errores encontrados, o -1 si no se pudo abrir.
+int parse_catalog(const char *filename, int threads, BookNode **out_head);
+
+// Igual que parse_catalog() pero sólo construye los libros cuyo ISBN es del
+// fragmento shard de nshards (ver isbn_shard): las cabeceras de los demás y
+// sus ejemplares se saltan sin reservar memoria. nshards <= 1: todo.
+int parse_catalog_shard(const char *filename, int threads, int shard, int nshards,
+                        BookNode **out_head);
+
+// Igual que parse_catalog() pero sobre un catálogo ya en memoria (p. ej.
+// recibido de otro receptor); name sólo se usa en los mensajes de error.
+int parse_catalog_mem(const char *name, const char *buf, size_t len, BookNode **out_head);
+
+// Libera una lista de libros devuelta por parse_catalog() y sus colas de espera
+void free_catalog(BookNode *head);
+
+#endif // LOADER_H
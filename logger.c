@@ -0,0 +1,227 @@
+// logger.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include "common.h"
+#include "logger.h"
+
+#define MAX_LOG_THREADS  32    // Anillos disponibles (uno por hilo productor)
+#define LOG_RING_SIZE    256   // Registros por anillo (potencia de 2)
+#define LOG_BATCH        64    // Registros máximos por llamada a writev
+#define LOG_FLUSH_MS     20    // Periodo de espera del hilo escritor
+
+// Registro de log ya formateado
+typedef struct {
+    int len;
+    char text[MAX_LINE_LEN];
+} LogRecord;
+
+// Anillo SPSC: el hilo dueño escribe en head, el hilo escritor avanza tail
+typedef struct {
+    LogRecord rec[LOG_RING_SIZE];
+    atomic_uint head;
+    atomic_uint tail;
+    atomic_ulong dropped;
+    atomic_int in_use;
+} LogRing;
+
+static LogRing rings[MAX_LOG_THREADS];
+static __thread LogRing *my_ring = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+static int log_fd = STDOUT_FILENO;
+static atomic_int log_level = LOG_ERROR;
+static int rate_limit = 0;
+static atomic_long rate_window = 0;
+static atomic_int rate_count = 0;
+static atomic_ulong rate_dropped = 0;
+
+static atomic_int running = 0;
+static atomic_int started = 0;
+static pthread_t writer_tid;
+
+static const char *level_name[] = { "ERROR", "INFO", "DEBUG" };
+
+// Al terminar un hilo se libera su anillo; lo pendiente lo vacía el escritor
+static void release_ring(void *arg) {
+    LogRing *r = arg;
+    atomic_store(&r->in_use, 0);
+}
+
+static void make_ring_key(void) {
+    pthread_key_create(&ring_key, release_ring);
+}
+
+// Devuelve el anillo del hilo actual, reservando uno libre la primera vez
+static LogRing *get_ring(void) {
+    if (my_ring) return my_ring;
+    pthread_once(&ring_key_once, make_ring_key);
+    for (int i = 0; i < MAX_LOG_THREADS; i++) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&rings[i].in_use, &expected, 1)) {
+            my_ring = &rings[i];
+            pthread_setspecific(ring_key, my_ring);
+            return my_ring;
+        }
+    }
+    return NULL;
+}
+
+// Límite de registros por ventana de un segundo
+static int rate_allows(void) {
+    if (rate_limit <= 0) return 1;
+    long now = (long)time(NULL);
+    long win = atomic_load(&rate_window);
+    if (win != now && atomic_compare_exchange_strong(&rate_window, &win, now)) {
+        atomic_store(&rate_count, 0);
+    }
+    if (atomic_fetch_add(&rate_count, 1) >= rate_limit) {
+        atomic_fetch_add(&rate_dropped, 1);
+        return 0;
+    }
+    return 1;
+}
+
+// Escribe todo el vector, reintentando si writev hace una escritura parcial
+static void writev_all(struct iovec *iov, int cnt) {
+    while (cnt > 0) {
+        ssize_t n = writev(log_fd, iov, cnt);
+        if (n < 0) return;
+        while (cnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+// Vacía todos los anillos en lotes; devuelve cuántos registros escribió
+static int drain_rings(void) {
+    int written = 0;
+    for (int i = 0; i < MAX_LOG_THREADS; i++) {
+        LogRing *r = &rings[i];
+        unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+        while (tail != head) {
+            struct iovec iov[LOG_BATCH];
+            int cnt = 0;
+            while (tail + cnt != head && cnt < LOG_BATCH) {
+                LogRecord *rec = &r->rec[(tail + cnt) % LOG_RING_SIZE];
+                iov[cnt].iov_base = rec->text;
+                iov[cnt].iov_len = rec->len;
+                cnt++;
+            }
+            writev_all(iov, cnt);
+            tail += cnt;
+            written += cnt;
+            atomic_store_explicit(&r->tail, tail, memory_order_release);
+        }
+
+        unsigned long lost = atomic_exchange(&r->dropped, 0);
+        if (lost) {
+            char msg[64];
+            int len = snprintf(msg, sizeof(msg), "[log] %lu registros descartados (anillo lleno)\n", lost);
+            write(log_fd, msg, len);
+        }
+    }
+    unsigned long limited = atomic_exchange(&rate_dropped, 0);
+    if (limited) {
+        char msg[64];
+        int len = snprintf(msg, sizeof(msg), "[log] %lu registros descartados (límite)\n", limited);
+        write(log_fd, msg, len);
+    }
+    return written;
+}
+
+// Hilo escritor: vacía los anillos periódicamente hasta logger_shutdown()
+static void *writer_thread(void *arg) {
+    struct timespec pause = { 0, LOG_FLUSH_MS * 1000000L };
+    while (atomic_load(&running)) {
+        if (drain_rings() == 0) {
+            nanosleep(&pause, NULL);
+        }
+    }
+    drain_rings();
+    return NULL;
+}
+
+int logger_init(const char *path, LogLevel level, int max_per_sec) {
+    if (path && path[0]) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) {
+            perror("Error al abrir archivo de log");
+            return -1;
+        }
+        log_fd = fd;
+    }
+    atomic_store(&log_level, level);
+    rate_limit = max_per_sec;
+    atomic_store(&running, 1);
+    atomic_store(&started, 1);
+    pthread_create(&writer_tid, NULL, writer_thread, NULL);
+    return 0;
+}
+
+int log_enabled(LogLevel level) {
+    return level <= atomic_load_explicit(&log_level, memory_order_relaxed);
+}
+
+void log_msg(LogLevel level, const char *fmt, ...) {
+    if (!log_enabled(level) || !rate_allows()) return;
+
+    LogRing *r = get_ring();
+    if (!r) {
+        // Sin anillo libre: no se bloquea, sólo se contabiliza en el primero
+        atomic_fetch_add(&rings[0].dropped, 1);
+        return;
+    }
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    if (head - tail == LOG_RING_SIZE) {
+        atomic_fetch_add(&r->dropped, 1);
+        return;
+    }
+
+    LogRecord *rec = &r->rec[head % LOG_RING_SIZE];
+    struct timespec ts;
+    struct tm tm_info;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    localtime_r(&ts.tv_sec, &tm_info);
+    int len = snprintf(rec->text, sizeof(rec->text), "%02d:%02d:%02d.%03ld [%s] ",
+                       tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec,
+                       ts.tv_nsec / 1000000L, level_name[level]);
+
+    va_list ap;
+    va_start(ap, fmt);
+    len += vsnprintf(rec->text + len, sizeof(rec->text) - len, fmt, ap);
+    va_end(ap);
+    // Asegura un único '\n' final aunque el mensaje se haya truncado
+    if (len > (int)sizeof(rec->text) - 2) len = sizeof(rec->text) - 2;
+    if (rec->text[len - 1] != '\n') rec->text[len++] = '\n';
+    rec->len = len;
+
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+
+    // Antes de logger_init() no hay hilo escritor: se vacía en línea
+    if (!atomic_load(&started)) drain_rings();
+}
+
+void logger_shutdown(void) {
+    if (!atomic_exchange(&running, 0)) return;
+    pthread_join(writer_tid, NULL);
+    if (log_fd != STDOUT_FILENO) close(log_fd);
+    log_fd = STDOUT_FILENO;
+}
@@ -0,0 +1,28 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+// Niveles de log: sólo se registran mensajes con nivel <= nivel configurado
+typedef enum {
+    LOG_ERROR = 0,
+    LOG_INFO  = 1,
+    LOG_DEBUG = 2
+} LogLevel;
+
+// Inicializa el logger asíncrono y lanza el hilo escritor.
+// path: archivo de salida (NULL → stdout); level: nivel máximo a registrar;
+// max_per_sec: límite de registros por segundo (0 = sin límite).
+// Devuelve 0 si todo fue bien, -1 si no se pudo abrir el archivo.
+int logger_init(const char *path, LogLevel level, int max_per_sec);
+
+// Indica si un mensaje de ese nivel se registraría (evita formatear en vano)
+int log_enabled(LogLevel level);
+
+// Formatea un registro y lo deja en el anillo del hilo que llama.
+// Nunca bloquea: si el anillo está lleno o se supera el límite, se descarta.
+void log_msg(LogLevel level, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// Vacía los anillos pendientes, detiene el hilo escritor y cierra el archivo.
+void logger_shutdown(void);
+
+#endif // LOGGER_H
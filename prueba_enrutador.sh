@@ -0,0 +1,38 @@
+#!/bin/sh
+# prueba_enrutador.sh
+#
+# Prueba de humo en una sola máquina: atiende peticiones.txt con un receptor
+# único y con "enrutador -n 3" sobre base.txt, y compara las respuestas.
+# Uso: sh prueba_enrutador.sh   (o "make prueba")
+
+set -e
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+# atender <nombre> <programa> [opciones...]
+atender() {
+    nombre=$1
+    shift
+    mkfifo "$DIR/consola.$nombre"
+    "$@" -p "$DIR/pipe.$nombre" -f base.txt < "$DIR/consola.$nombre" \
+        > "$DIR/$nombre.log" 2>&1 &
+    pid=$!
+    exec 3> "$DIR/consola.$nombre"
+    while [ ! -p "$DIR/pipe.$nombre" ]; do sleep 0.1; done
+    ./solicitante -p "$DIR/pipe.$nombre" -i peticiones.txt > "$DIR/$nombre.out"
+    echo s >&3
+    exec 3>&-
+    wait $pid
+}
+
+atender unico ./receptor
+atender fragmentos ./enrutador -n 3
+
+if diff -u "$DIR/unico.out" "$DIR/fragmentos.out"; then
+    echo "OK: enrutador -n 3 responde igual que un receptor único" \
+         "($(wc -l < "$DIR/unico.out") respuestas)"
+else
+    echo "FALLO: las respuestas difieren" >&2
+    cat "$DIR/fragmentos.log" >&2
+    exit 1
+fi
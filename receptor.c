@@ -5,22 +5,154 @@
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
 #include <pthread.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <getopt.h>
+#include <limits.h>
 #include "common.h"
+#include "admision.h"
 #include "buffer.h"
 #include "db.h"
+#include "logger.h"
+#include "replica.h"
+#include "report.h"
+#include "shm_ring.h"
+
+#define SHM_LIVENESS_MS  1000    // Cada cuánto se comprueba que un cliente shm siga vivo
+#define MAX_SHM_CLIENTS  32      // Clientes por memoria compartida a la vez (un hilo cada uno)
 
 static char fifo_name[FIFO_NAME_LEN];   
 static char db_filename[128];          
 static char out_filename[128];          
 static int verbose = 0;                 
+static char log_filename[128];          
+static int log_level = -1;              
+static int log_rate = 0;                
 static int keep_running = 1;            
+static int checkpoint_secs = 0;         
+static int load_threads = 1;            
+static int fifo_fd = -1;                
+static int reply_fd = -1;               
+static int shard_index = 0;             
+static int shard_count = 1;             
+static char reply_prefix[FIFO_NAME_LEN];
+static int reload_running = 0;          
+static int client_rate = 0;             
+static int deadline_ms = 0;             
+static pthread_t work_tid;              
+static int shm_clients = 0;             
+
+/* Cliente por memoria compartida: el nombre y el pid salen de la petición
+   'M' y se guardan aquí, no en la región, que el cliente puede escribir */
+typedef struct {
+    ShmChannel* ch;
+    pid_t pid;
+    char name[SHM_NAME_LEN];
+} ShmClient;
+
+/* Estado del hilo de checkpoints: lo despierta el periodo o el comando 'c' */
+static pthread_t ckpt_tid;
+static pthread_mutex_t ckpt_mux = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ckpt_cond = PTHREAD_COND_INITIALIZER;
+static int ckpt_requested = 0;
+static int ckpt_stop = 0;
+
+/*
+ * Un FIFO de respuesta sólo es aceptable si se llama “<pipe>.<algo>”, sin
+ * más '/', como el que crea solicitante: el FIFO común es 0666 y no se
+ * puede dejar que cualquiera haga escribir al receptor en rutas arbitrarias.
+ * <pipe> es el FIFO propio, o el público del enrutador si se indicó -a.
+ */
+static int reply_fifo_allowed(const char* path) {
+    size_t plen = strlen(reply_prefix);
+    return strncmp(path, reply_prefix, plen) == 0 && path[plen] == '.' &&
+           path[plen + 1] && !strchr(path + plen + 1, '/');
+}
 
 /*
- * Hilo que procesa en segundo plano las tareas de renovación y devolución
- * que se encolan en task_buffer.
+ * Escribe una línea en el FIFO de respuesta de un cliente sin bloquear.
+ * Devuelve -1 si el cliente ya no tiene el FIFO abierto o si la ruta no es
+ * un FIFO (nunca se escribe en archivos normales ni dispositivos).
+ */
+static int write_client_fifo(const char* path, const char* msg) {
+    int cfd = open(path, O_WRONLY | O_NONBLOCK | O_NOCTTY);
+    if (cfd < 0) {
+        return -1;
+    }
+    struct stat sb;
+    if (fstat(cfd, &sb) != 0 || !S_ISFIFO(sb.st_mode)) {
+        close(cfd);
+        return -1;
+    }
+    ssize_t n = write(cfd, msg, strlen(msg));
+    close(cfd);
+    return n == (ssize_t)strlen(msg) ? 0 : -1;
+}
+
+/*
+ * Envía la respuesta por el anillo de memoria compartida si la petición
+ * llegó por él; si no, por el FIFO propio del cliente si lo indicó en la
+ * petición, o por el FIFO común del receptor en caso contrario.
+ */
+static void send_reply(const Request* req, int client_fd, ShmChannel* shm,
+                       const char* response) {
+    if (shm) {
+        if (shm_ring_push_timeout(&shm->rep, response, SHM_LIVENESS_MS) != 0) {
+            log_msg(LOG_ERROR, "Cliente shm no recoge respuestas");
+        }
+    } else if (req->reply_fifo[0]) {
+        if (write_client_fifo(req->reply_fifo, response) != 0) {
+            log_msg(LOG_ERROR, "No se pudo responder por \"%s\"", req->reply_fifo);
+        }
+    } else {
+        write(client_fd, response, strlen(response));
+    }
+}
+
+/*
+ * Respuesta rápida cuando la petición no se atiende: el cliente supera su
+ * límite, la cola de su clase está llena o venció su plazo en la cola.
+ */
+static void send_busy(const Request* req, int client_fd, ShmChannel* shm) {
+    char response[MAX_LINE_LEN];
+    snprintf(response, sizeof(response), "FAIL,Ocupado,%d\n", req->isbn);
+    send_reply(req, client_fd, shm, response);
+    log_msg(LOG_DEBUG, "Petición op=%d ISBN=%d rechazada por sobrecarga", req->op, req->isbn);
+}
+
+/*
+ * Avisa al cliente de una reserva que se le asignó el ejemplar devuelto.
+ * Si el cliente ya no escucha, el ejemplar se devuelve de nuevo para que
+ * pase al siguiente de la cola.
+ */
+static void deliver_hold(Task t) {
+    while (1) {
+        char msg[MAX_LINE_LEN];
+        snprintf(msg, sizeof(msg), "OK,Reserva,%d,%d,%s\n", t.isbn, t.ejemplar, t.date);
+        if (write_client_fifo(t.reply_fifo, msg) == 0) {
+            log_msg(LOG_INFO, "Reserva entregada: ISBN %d ejemplar %d a \"%s\"",
+                    t.isbn, t.ejemplar, t.reply_fifo);
+            return;
+        }
+        log_msg(LOG_INFO, "Cliente \"%s\" no disponible; la reserva pasa al siguiente",
+                t.reply_fifo);
+        HoldEntry* next = NULL;
+        if (do_devolver(t.isbn, t.ejemplar, &next, t.date) != 0 || !next) {
+            return;
+        }
+        strncpy(t.reply_fifo, next->reply_fifo, FIFO_NAME_LEN);
+        free(next);
+    }
+}
+
+/*
+ * Hilo que procesa en segundo plano las tareas de renovación que se
+ * encolan en task_buffer y entrega los avisos de reservas (la devolución
+ * se hace en el acto y sólo encola el aviso, como OP_RESERVAR).
  */
 void* aux1_thread(void* arg) {
     while (1) {
@@ -29,8 +161,8 @@ void* aux1_thread(void* arg) {
             /* Si recibe OP_SALIR, sale del hilo */
             break;
         }
-        if (t.op == OP_DEVOLVER) {
-            do_devolver(t.isbn, t.ejemplar);
+        if (t.op == OP_RESERVAR) {
+            deliver_hold(t);
         } else if (t.op == OP_RENOVAR) {
             char dummy_date[DATE_STR_LEN];
             do_renovar(t.isbn, t.ejemplar, dummy_date);
@@ -39,26 +171,156 @@ void* aux1_thread(void* arg) {
     return NULL;
 }
 
+/*
+ * Hilo que escribe instantáneas de la BD en out_filename sin detener el
+ * servicio: cada checkpoint_secs segundos (si -c > 0) o al pedirlo con 'c'.
+ * La escritura la hace un proceso hijo (snapshot_db); aquí sólo se espera.
+ */
+void* checkpoint_thread(void* arg) {
+    pthread_mutex_lock(&ckpt_mux);
+    while (!ckpt_stop) {
+        if (checkpoint_secs > 0) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += checkpoint_secs;
+            while (!ckpt_requested && !ckpt_stop) {
+                if (pthread_cond_timedwait(&ckpt_cond, &ckpt_mux, &deadline) != 0) {
+                    break;  /* venció el periodo */
+                }
+            }
+        } else {
+            while (!ckpt_requested && !ckpt_stop) {
+                pthread_cond_wait(&ckpt_cond, &ckpt_mux);
+            }
+        }
+        if (ckpt_stop) break;
+        ckpt_requested = 0;
+        pthread_mutex_unlock(&ckpt_mux);
+
+        if (!out_filename[0]) {
+            log_msg(LOG_ERROR, "Checkpoint ignorado: falta archivo de salida (-s).");
+        } else {
+            pid_t pid = snapshot_db(out_filename);
+            int status;
+            if (pid > 0 && waitpid(pid, &status, 0) == pid &&
+                WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                log_msg(LOG_INFO, "Checkpoint de BD escrito en \"%s\".", out_filename);
+            } else {
+                log_msg(LOG_ERROR, "Falló el checkpoint de BD en \"%s\".", out_filename);
+            }
+        }
+
+        pthread_mutex_lock(&ckpt_mux);
+    }
+    pthread_mutex_unlock(&ckpt_mux);
+    return NULL;
+}
+
+/*
+ * Hilo de recarga en caliente (comando 'l'): analiza el archivo nuevo y lo
+ * mezcla con la BD en uso mientras el receptor sigue atendiendo peticiones.
+ */
+void* reload_thread(void* arg) {
+    char* filename = arg;
+    ReloadStats st;
+    if (reload_db(filename, load_threads, shard_index, shard_count, &st) == 0) {
+        log_msg(LOG_INFO, "Recargado \"%s\": %d libros (%d actualizados, %d nuevos,"
+                " %d retirados, %d conservados en uso), %d errores, %d reservas atendidas",
+                filename, st.books, st.updated, st.added, st.removed,
+                st.kept_books, st.errors, st.nserved);
+        /* Ejemplares nuevos que pasaron a clientes en espera: aux1 les avisa */
+        for (int i = 0; i < st.nserved; i++) {
+            buffer_push(&task_buffer, st.served[i]);
+        }
+        free(st.served);
+    } else {
+        log_msg(LOG_ERROR, "No se pudo recargar \"%s\"", filename);
+    }
+    free(filename);
+    __atomic_store_n(&reload_running, 0, __ATOMIC_RELEASE);
+    return NULL;
+}
+
 /*
  * Hilo que atiende comandos locales en receptor:
  *   - 'r': imprime reporte de logs (print_report)
+ *   - 'q [isbn=N] [estado=P|R|D] [desde=DD-MM-YYYY] [hasta=DD-MM-YYYY] [top=N]':
+ *          consulta filtrada de logs con resumen por título (run_report);
+ *          desde/hasta se refieren al día de la operación
+ *   - 'c': pide un checkpoint de la BD en segundo plano
+ *   - 'l [archivo]': recarga el catálogo en caliente (por defecto el de -f)
+ *   - 'p': promueve la réplica (-S) a primario
  *   - 's': guarda BD final (save_db) y ordena cierre de todo el receptor
  */
 void* aux2_thread(void* arg) {
     while (keep_running) {
-        char cmd = getchar();
+        int cmd = getchar();
+        if (cmd == EOF) {
+            /* Sin consola (stdin cerrado): dejar de leer comandos */
+            break;
+        }
         if (cmd == 'r') {
             print_report();
+        } else if (cmd == 'q') {
+            char args[MAX_LINE_LEN];
+            ReportQuery q;
+            if (!fgets(args, sizeof(args), stdin)) break;
+            if (parse_report_query(args, &q) == 0) {
+                run_report(&q, stdout);
+                fflush(stdout);
+            } else {
+                fprintf(stderr, "Consulta inválida. Uso: q [isbn=N] [estado=P|R|D]"
+                                " [desde=DD-MM-YYYY] [hasta=DD-MM-YYYY] [top=N]\n");
+            }
+        } else if (cmd == 'l') {
+            char args[MAX_LINE_LEN];
+            if (!fgets(args, sizeof(args), stdin)) break;
+            char* name = args;
+            while (*name == ' ') name++;
+            name[strcspn(name, "\r\n")] = '\0';
+            if (!name[0]) name = db_filename;
+            pthread_t tid;
+            if (__atomic_exchange_n(&reload_running, 1, __ATOMIC_ACQ_REL)) {
+                fprintf(stderr, "Ya hay una recarga en curso.\n");
+            } else if (pthread_create(&tid, NULL, reload_thread, strdup(name)) == 0) {
+                pthread_detach(tid);
+            } else {
+                __atomic_store_n(&reload_running, 0, __ATOMIC_RELEASE);
+            }
+        } else if (cmd == 'p') {
+            if (replica_is_standby()) {
+                replica_promote();
+            } else {
+                fprintf(stderr, "El receptor ya es primario.\n");
+            }
+        } else if (cmd == 'c') {
+            pthread_mutex_lock(&ckpt_mux);
+            ckpt_requested = 1;
+            pthread_cond_signal(&ckpt_cond);
+            pthread_mutex_unlock(&ckpt_mux);
         } else if (cmd == 's') {
             keep_running = 0;  // Señal para terminar
+            /* Primero vaciar la cola de peticiones: el trabajador puede
+               necesitar task_buffer para avisar de reservas */
+            adm_shutdown();
+            pthread_join(work_tid, NULL);
             Task t = { .op = OP_SALIR };
             buffer_push(&task_buffer, t);
+            /* Esperar a que termine un checkpoint en curso para que no
+               sobrescriba el guardado final con datos más antiguos */
+            pthread_mutex_lock(&ckpt_mux);
+            ckpt_stop = 1;
+            pthread_cond_signal(&ckpt_cond);
+            pthread_mutex_unlock(&ckpt_mux);
+            pthread_join(ckpt_tid, NULL);
             if (out_filename[0]) {
                 save_db(out_filename);
-                if (verbose) {
-                    printf("Guardada BD en \"%s\" y receptor cerrándose (comando 's').\n",
-                           out_filename);
-                }
+                log_msg(LOG_INFO, "Guardada BD en \"%s\" y receptor cerrándose (comando 's').",
+                        out_filename);
+            }
+            /* Despertar al bucle principal, bloqueado en read() del FIFO */
+            if (fifo_fd >= 0) {
+                write(fifo_fd, "\n", 1);
             }
             break;
         }
@@ -66,13 +328,96 @@ void* aux2_thread(void* arg) {
     return NULL;
 }
 
-void handle_request(Request* req, int client_fd) {
+void* shm_client_thread(void* arg);
+
+/*
+ * Conecta con la región "/sol_<pid>" que pide un cliente con 'M'. Sólo se
+ * aceptan nombres de esa forma (el pid sirve para ver si el cliente sigue
+ * vivo) y hasta MAX_SHM_CLIENTS a la vez. Devuelve NULL si no se acepta.
+ */
+static ShmClient* shm_client_open(const char* name) {
+    char* end;
+    if (strncmp(name, "/sol_", 5) != 0 || strlen(name) >= SHM_NAME_LEN) {
+        return NULL;
+    }
+    long pid = strtol(name + 5, &end, 10);
+    if (end == name + 5 || *end || pid <= 1) {
+        return NULL;
+    }
+    if (__atomic_add_fetch(&shm_clients, 1, __ATOMIC_ACQ_REL) > MAX_SHM_CLIENTS) {
+        __atomic_sub_fetch(&shm_clients, 1, __ATOMIC_ACQ_REL);
+        log_msg(LOG_ERROR, "Cliente shm \"%s\" rechazado: ya hay %d conectados",
+                name, MAX_SHM_CLIENTS);
+        return NULL;
+    }
+    ShmChannel* ch = shm_channel_attach(name);
+    if (!ch) {
+        __atomic_sub_fetch(&shm_clients, 1, __ATOMIC_ACQ_REL);
+        return NULL;
+    }
+    ShmClient* sc = malloc(sizeof(ShmClient));
+    sc->ch = ch;
+    sc->pid = (pid_t)pid;
+    strcpy(sc->name, name);
+    return sc;
+}
+
+static void shm_client_close(ShmClient* sc) {
+    shm_channel_detach(sc->ch);
+    free(sc);
+    __atomic_sub_fetch(&shm_clients, 1, __ATOMIC_ACQ_REL);
+}
+void handle_request(Request* req, int client_fd, ShmChannel* shm);
+
+/*
+ * Hilo trabajador: ejecuta las peticiones del FIFO en el orden que decide
+ * el planificador (mostrador antes que masivas); las vencidas se rechazan.
+ */
+void* work_thread(void* arg) {
+    Request req;
+    int late;
+    while (adm_next(&req, &late) == 0) {
+        if (late) {
+            send_busy(&req, reply_fd, NULL);
+        } else {
+            handle_request(&req, reply_fd, NULL);
+        }
+    }
+    return NULL;
+}
+
+static void serve_request(Request* req, int client_fd, ShmChannel* shm) {
     char response[MAX_LINE_LEN];
 
     /* 1) Si es OP_SALIR (Q), devolvemos "BYE\n" y regresamos */
     if (req->op == OP_SALIR) {
         snprintf(response, sizeof(response), "BYE\n");
-        write(client_fd, response, strlen(response));
+        send_reply(req, client_fd, shm, response);
+        return;
+    }
+
+    /* 1.1) OP_MEMORIA (M): el cliente pide pasar a memoria compartida; el
+       campo título trae el nombre de la región creada con shm_open */
+    if (req->op == OP_MEMORIA) {
+        ShmClient* sc = shm ? NULL : shm_client_open(req->title);
+        pthread_t tid;
+        if (sc && pthread_create(&tid, NULL, shm_client_thread, sc) == 0) {
+            pthread_detach(tid);
+            snprintf(response, sizeof(response), "OK,Memoria\n");
+            log_msg(LOG_INFO, "Cliente conectado por memoria compartida \"%s\"", req->title);
+        } else {
+            if (sc) shm_client_close(sc);
+            snprintf(response, sizeof(response), "FAIL,Memoria,0\n");
+        }
+        send_reply(req, client_fd, shm, response);
+        return;
+    }
+
+    /* 1.2) Mientras sea réplica sólo se atienden consultas: el estado lo
+       escribe el flujo del primario */
+    if (req->op != OP_CONSULTAR && replica_is_standby()) {
+        snprintf(response, sizeof(response), "FAIL,Replica,%d\n", req->isbn);
+        send_reply(req, client_fd, shm, response);
         return;
     }
 
@@ -83,10 +428,8 @@ void handle_request(Request* req, int client_fd) {
         snprintf(response, sizeof(response),
                  "FAIL,NoExiste,%d\n",
                  req->isbn);
-        write(client_fd, response, strlen(response));
-        if (verbose) {
-            printf("Manejada operación [X] \"NoExiste\" (ISBN: %d)\n", req->isbn);
-        }
+        send_reply(req, client_fd, shm, response);
+        log_msg(LOG_INFO, "Manejada operación [X] \"NoExiste\" (ISBN: %d)", req->isbn);
         return;
     }
 
@@ -95,10 +438,8 @@ void handle_request(Request* req, int client_fd) {
         snprintf(response, sizeof(response),
                  "FAIL,NoExiste,%d\n",
                  req->isbn);
-        write(client_fd, response, strlen(response));
-        if (verbose) {
-            printf("Manejada operación [X] \"NoExiste\" (ISBN: %d)\n", req->isbn);
-        }
+        send_reply(req, client_fd, shm, response);
+        log_msg(LOG_INFO, "Manejada operación [X] \"NoExiste\" (ISBN: %d)", req->isbn);
         return;
     }
 
@@ -115,7 +456,7 @@ void handle_request(Request* req, int client_fd) {
                      "FAIL,NoDisponible,%d\n",
                      req->isbn);
         }
-        write(client_fd, response, strlen(response));
+        send_reply(req, client_fd, shm, response);
     }
     else if (req->op == OP_RENOVAR) {
         int ejemplar = -1;
@@ -138,7 +479,7 @@ void handle_request(Request* req, int client_fd) {
                      "FAIL,NoExiste,%d\n",
                      req->isbn);
         }
-        write(client_fd, response, strlen(response));
+        send_reply(req, client_fd, shm, response);
     }
     else if (req->op == OP_DEVOLVER) {
         int ejemplar = -1;
@@ -148,36 +489,195 @@ void handle_request(Request* req, int client_fd) {
                 break;
             }
         }
-        if (ejemplar >= 0 && do_devolver(req->isbn, ejemplar) == 0) {
+        HoldEntry* hold = NULL;
+        char hold_date[DATE_STR_LEN];
+        if (ejemplar >= 0 && do_devolver(req->isbn, ejemplar, &hold, hold_date) == 0) {
             snprintf(response, sizeof(response),
                      "OK,Devuelto,%d,%d\n",
                      req->isbn, ejemplar);
-            Task t = { .op = OP_DEVOLVER, .isbn = req->isbn, .ejemplar = ejemplar };
+        } else {
+            snprintf(response, sizeof(response),
+                     "FAIL,NoExiste,%d\n",
+                     req->isbn);
+        }
+        send_reply(req, client_fd, shm, response);
+        /* Si el ejemplar pasó a un cliente en espera, aux1_thread le avisa */
+        if (hold) {
+            Task t = { .op = OP_RESERVAR, .isbn = req->isbn, .ejemplar = ejemplar };
+            strncpy(t.date, hold_date, DATE_STR_LEN);
+            strncpy(t.reply_fifo, hold->reply_fifo, FIFO_NAME_LEN);
+            free(hold);
             buffer_push(&task_buffer, t);
+        }
+    }
+    else if (req->op == OP_RESERVAR) {
+        /* La reserva necesita el FIFO propio del cliente para el aviso */
+        int ejemplar, pos;
+        char due_date[DATE_STR_LEN];
+        int rc = req->reply_fifo[0]
+               ? do_reservar(req->isbn, req->reply_fifo, &ejemplar, due_date, &pos)
+               : -1;
+        if (!req->reply_fifo[0]) {
+            snprintf(response, sizeof(response),
+                     "FAIL,SinCanal,%d\n",
+                     req->isbn);
+        } else if (rc == 1) {
+            snprintf(response, sizeof(response),
+                     "OK,Prestado,%d,%d,%s\n",
+                     req->isbn, ejemplar, due_date);
+        } else if (rc == 0) {
+            snprintf(response, sizeof(response),
+                     "OK,EnEspera,%d,%d\n",
+                     req->isbn, pos);
         } else {
             snprintf(response, sizeof(response),
                      "FAIL,NoExiste,%d\n",
                      req->isbn);
         }
-        write(client_fd, response, strlen(response));
+        send_reply(req, client_fd, shm, response);
+    }
+    else if (req->op == OP_CONSULTAR) {
+        int avail, total;
+        if (do_consultar(req->isbn, &avail, &total) == 0) {
+            snprintf(response, sizeof(response),
+                     "OK,Disponibles,%d,%d,%d\n",
+                     req->isbn, avail, total);
+        } else {
+            snprintf(response, sizeof(response),
+                     "FAIL,NoExiste,%d\n",
+                     req->isbn);
+        }
+        send_reply(req, client_fd, shm, response);
     }
 
-    if (verbose) {
+    if (log_enabled(LOG_INFO)) {
         char op_char = '?';
         if (req->op == OP_PRESTAMO)    op_char = 'P';
         else if (req->op == OP_RENOVAR) op_char = 'R';
         else if (req->op == OP_DEVOLVER)op_char = 'D';
+        else if (req->op == OP_RESERVAR)op_char = 'H';
+        else if (req->op == OP_MEMORIA) op_char = 'M';
+        else if (req->op == OP_CONSULTAR)op_char = 'C';
         else if (req->op == OP_SALIR)   op_char = 'Q';
-        printf("Manejada operación [%c] \"%s\" (ISBN: %d)\n",
-               op_char, req->title, req->isbn);
+        log_msg(LOG_INFO, "Manejada operación [%c] \"%s\" (ISBN: %d)",
+                op_char, req->title, req->isbn);
     }
 }
 
+/*
+ * Atiende una petición dentro de una sección de lectura de la BD: los
+ * BookNode que serve_request() usa sin db_mux no se liberan aunque una
+ * recarga publique otro catálogo mientras tanto.
+ */
+void handle_request(Request* req, int client_fd, ShmChannel* shm) {
+    db_read_begin();
+    serve_request(req, client_fd, shm);
+    db_read_end();
+}
+
+/*
+ * Interpreta una línea “Op,Título,ISBN[,FIFOrespuesta]”.
+ * Devuelve -1 si la línea no es una petición (vacía o una respuesta
+ * “OK/FAIL/BYE” escrita en el FIFO común y leída por el propio receptor).
+ */
+static int parse_request(char* line, Request* req) {
+    memset(req, 0, sizeof(*req));
+    line[strcspn(line, "\r")] = '\0';
+    if (!line[0] || strncmp(line, "OK,", 3) == 0 ||
+        strncmp(line, "FAIL,", 5) == 0 || strncmp(line, "BYE", 3) == 0) {
+        return -1;
+    }
+
+    char* save;
+    char* t0 = strtok_r(line, ",", &save);
+    if (!t0) return -1;
+    char op_char = t0[0];
+    /* Normalizar a mayúscula */
+    if (op_char >= 'a' && op_char <= 'z') {
+        op_char -= 32;
+    }
+    if (op_char == 'P')       req->op = OP_PRESTAMO;
+    else if (op_char == 'R')  req->op = OP_RENOVAR;
+    else if (op_char == 'D')  req->op = OP_DEVOLVER;
+    else if (op_char == 'H')  req->op = OP_RESERVAR;
+    else if (op_char == 'M')  req->op = OP_MEMORIA;
+    else if (op_char == 'C')  req->op = OP_CONSULTAR;
+    else                      req->op = OP_SALIR;
+
+    /* Extraer Título (sin espacios al inicio) */
+    char* t1 = strtok_r(NULL, ",", &save);
+    if (t1) {
+        while (*t1 == ' ') t1++;
+        strncpy(req->title, t1, MAX_TITLE_LEN - 1);
+        /* Extraer ISBN */
+        char* t2 = strtok_r(NULL, ",", &save);
+        if (t2) {
+            while (*t2 == ' ') t2++;
+            req->isbn = atoi(t2);
+            /* FIFO de respuesta del cliente (opcional) */
+            char* t3 = strtok_r(NULL, ",", &save);
+            if (t3) {
+                while (*t3 == ' ') t3++;
+                if (!reply_fifo_allowed(t3)) {
+                    log_msg(LOG_ERROR, "Petición descartada: FIFO de respuesta no válido \"%s\"", t3);
+                    return -1;
+                }
+                strncpy(req->reply_fifo, t3, FIFO_NAME_LEN - 1);
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * Hilo que atiende a un cliente conectado por memoria compartida: saca
+ * peticiones del anillo req y responde en el anillo rep, sin pasar por el
+ * kernel salvo cuando alguno de los dos lados tiene que dormir.
+ * Si el cliente muere sin enviar 'Q' (kill, Ctrl-C), la espera con plazo
+ * permite notarlo y liberar el hilo y la región.
+ */
+void* shm_client_thread(void* arg) {
+    ShmClient* sc = arg;
+    ShmChannel* ch = sc->ch;
+    char line[MAX_LINE_LEN];
+    /* Cliente con hilo propio: no pasa por las colas, sólo por su límite */
+    char client[FIFO_NAME_LEN];
+    snprintf(client, sizeof(client), "shm:%p", (void*)ch);
+    while (keep_running) {
+        Request req;
+        if (shm_ring_pop_timeout(&ch->req, line, SHM_LIVENESS_MS) != 0) {
+            if (kill(sc->pid, 0) != 0 && errno == ESRCH) {
+                log_msg(LOG_INFO, "Cliente shm %d terminó sin 'Q'; se libera su canal",
+                        (int)sc->pid);
+                shm_unlink(sc->name);
+                break;
+            }
+            continue;
+        }
+        line[strcspn(line, "\n")] = '\0';
+        if (parse_request(line, &req) != 0) {
+            continue;
+        }
+        if (req.op != OP_SALIR && !adm_allow(client)) {
+            send_busy(&req, -1, ch);
+            continue;
+        }
+        handle_request(&req, -1, ch);
+        if (req.op == OP_SALIR) {
+            break;
+        }
+    }
+    shm_client_close(sc);
+    return NULL;
+}
+
 int main(int argc, char* argv[]) {
     int opt;
     char pipe_arg[64] = {0};
     char file_arg[128] = {0};
     char out_arg[128] = {0};
+    char serve_arg[108] = {0};
+    char follow_arg[108] = {0};
 
     /*
      * Parsear opciones:
@@ -185,39 +685,104 @@ int main(int argc, char* argv[]) {
      *   -f <file>   → archivo de BD inicial
      *   -v          → modo verbose
      *   -s <file>   → archivo BD final al cerrar
+     *   -l <file>   → archivo de log (por defecto stdout)
+     *   -n <nivel>  → nivel de log: 0=errores, 1=info (-v), 2=debug
+     *   -m <n>      → máximo de registros de log por segundo (0 = sin límite)
+     *   -c <seg>    → periodo de checkpoints en segundo plano hacia -s
+     *   -j <n>      → hilos para cargar la BD inicial en paralelo
+     *   -k <i>/<n>  → fragmento i de n: sólo carga los ISBN de ese fragmento
+     *   -a <fifo>   → FIFO público con el que nombran los clientes sus FIFOs
+     *                 de respuesta (por defecto el de -p; lo usa el enrutador)
+     *   -R <sock>   → primario: envía los cambios a una réplica por ese socket
+     *   -S <sock>   → réplica: sigue al primario de ese socket (-f opcional)
+     *   -t <n>      → máximo de peticiones por segundo de cada cliente
+     *   -d <ms>     → plazo en cola de P/H/C (R/D: 10 veces más); vencido,
+     *                 se responde FAIL,Ocupado
      */
-    while ((opt = getopt(argc, argv, "p:f:vs:")) != -1) {
+    while ((opt = getopt(argc, argv, "p:f:vs:l:n:m:c:j:k:a:R:S:t:d:")) != -1) {
         switch (opt) {
             case 'p': strncpy(pipe_arg, optarg, sizeof(pipe_arg)); break;
             case 'f': strncpy(file_arg, optarg, sizeof(file_arg)); break;
             case 'v': verbose = 1; break;
             case 's': strncpy(out_arg, optarg, sizeof(out_arg)); break;
+            case 'l': strncpy(log_filename, optarg, sizeof(log_filename)); break;
+            case 'n': log_level = atoi(optarg); break;
+            case 'm': log_rate = atoi(optarg); break;
+            case 'c': checkpoint_secs = atoi(optarg); break;
+            case 'j': load_threads = atoi(optarg); break;
+            case 'a': strncpy(reply_prefix, optarg, FIFO_NAME_LEN - 1); break;
+            case 'k':
+                if (sscanf(optarg, "%d/%d", &shard_index, &shard_count) != 2 ||
+                    shard_count < 1 || shard_index < 0 || shard_index >= shard_count) {
+                    fprintf(stderr, "Error: fragmento inválido \"%s\" (use i/n).\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'R': strncpy(serve_arg, optarg, sizeof(serve_arg) - 1); break;
+            case 'S': strncpy(follow_arg, optarg, sizeof(follow_arg) - 1); break;
+            case 't': client_rate = atoi(optarg); break;
+            case 'd': deadline_ms = atoi(optarg); break;
             default:
                 fprintf(stderr,
-                        "Uso: %s -p pipeReceptor -f filedatos [-v] [-s filesalida]\n",
+                        "Uso: %s -p pipeReceptor -f filedatos [-v] [-s filesalida]"
+                        " [-l filelog] [-n nivel] [-m maxPorSeg] [-c segCheckpoint]"
+                        " [-j hilosCarga] [-k fragmento/total] [-a pipePublico]"
+                        " [-R socketPrimario] [-S socketReplica]"
+                        " [-t maxPorCliente] [-d plazoMs]\n",
                         argv[0]);
                 exit(1);
         }
     }
 
-    if (!pipe_arg[0] || !file_arg[0]) {
+    if (!pipe_arg[0] || (!file_arg[0] && !follow_arg[0])) {
         fprintf(stderr, "Error: faltan parámetros obligatorios.\n");
         exit(1);
     }
     strncpy(fifo_name, pipe_arg, FIFO_NAME_LEN);
+    if (!reply_prefix[0]) {
+        strncpy(reply_prefix, fifo_name, FIFO_NAME_LEN - 1);
+    }
     strncpy(db_filename, file_arg, sizeof(db_filename));
     if (out_arg[0]) {
         strncpy(out_filename, out_arg, sizeof(out_filename));
     }
 
-    /* 1) Cargar la BD inicial */
-    load_db(db_filename);
+    /* 0) Arrancar el logger asíncrono: -v equivale a nivel info */
+    if (log_level < 0) {
+        log_level = verbose ? LOG_INFO : LOG_ERROR;
+    }
+    if (log_level > LOG_DEBUG) {
+        log_level = LOG_DEBUG;
+    }
+    if (logger_init(log_filename[0] ? log_filename : NULL, log_level, log_rate) != 0) {
+        exit(1);
+    }
+
+    /* 1) Cargar la BD inicial (sólo los libros del fragmento si hay -k); la
+       réplica la recibe del primario, pero si tiene -f arranca con ese
+       catálogo hasta la primera instantánea */
+    if (db_filename[0]) {
+        load_db(db_filename, load_threads, shard_index, shard_count);
+    }
+    if (shard_count > 1) {
+        log_msg(LOG_INFO, "Fragmento %d de %d cargado desde \"%s\"",
+                shard_index, shard_count, db_filename);
+    }
+
+    /* 1.1) Replicación: la réplica sigue al primario y, si además tiene -R,
+       servirá a su propia réplica cuando la promuevan */
+    if (follow_arg[0] && replica_follow(follow_arg) != 0) {
+        exit(1);
+    }
+    if (serve_arg[0] && replica_serve(serve_arg) != 0) {
+        exit(1);
+    }
 
     /* 2) Inicializar buffer de tareas y lanzar hilos auxiliares */
     buffer_init(&task_buffer);
     pthread_t tid1, tid2;
     pthread_create(&tid1, NULL, aux1_thread, NULL);
-    pthread_create(&tid2, NULL, aux2_thread, NULL);
+    pthread_create(&ckpt_tid, NULL, checkpoint_thread, NULL);
 
     /* 3) Crear el FIFO (o reutilizar si ya existe) */
     mkfifo(fifo_name, 0666);
@@ -229,44 +794,60 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
+    fifo_fd = fd;
+    /* Las respuestas sin FIFO propio vuelven al FIFO común, del que sólo lee
+       este receptor: escribirlas bloqueando podría dejarlo esperándose a sí
+       mismo con el FIFO lleno, así que si no caben se descartan */
+    reply_fd = open(fifo_name, O_WRONLY | O_NONBLOCK);
+
+    /* 4.1) Control de admisión: el bucle principal sólo clasifica y encola;
+       el trabajador ejecuta. La consola arranca después porque 's' espera
+       al trabajador */
+    adm_init(client_rate, deadline_ms);
+    pthread_create(&work_tid, NULL, work_thread, NULL);
+    pthread_create(&tid2, NULL, aux2_thread, NULL);
+
     /* 5) Bucle infinito atendiendo peticiones */
+    char buf[2 * PIPE_BUF + 1];
+    size_t kept = 0;
     while (keep_running) {
-        char buf[MAX_LINE_LEN];
-        ssize_t n = read(fd, buf, sizeof(buf) - 1);
+        ssize_t n = read(fd, buf + kept, sizeof(buf) - 1 - kept);
         if (n <= 0) {
             continue;  /* si no llegó nada, vuelvo a leer */
         }
-        buf[n] = '\0';
+        size_t len = kept + n;
+        buf[len] = '\0';
 
-        /* 5.1) Parsear “Op,Title,ISBN\n” */
-        Request req;
-        char* t0 = strtok(buf, ",");
-        if (!t0) continue;
-        char op_char = t0[0];
-        /* Normalizar a mayúscula */
-        if (op_char >= 'a' && op_char <= 'z') {
-            op_char -= 32;
-        }
-        if (op_char == 'P')       req.op = OP_PRESTAMO;
-        else if (op_char == 'R')  req.op = OP_RENOVAR;
-        else if (op_char == 'D')  req.op = OP_DEVOLVER;
-        else                      req.op = OP_SALIR;
-
-        /* 5.2) Extraer Título (sin espacios al inicio) */
-        char* t1 = strtok(NULL, ",");
-        if (t1) {
-            while (*t1 == ' ') t1++;
-            strncpy(req.title, t1, MAX_TITLE_LEN);
-            /* 5.3) Extraer ISBN */
-            char* t2 = strtok(NULL, ",");
-            if (t2) {
-                while (*t2 == ' ') t2++;
-                req.isbn = atoi(t2);
+        /* 5.1) Cada write() de un cliente es atómico (< PIPE_BUF), pero una
+           lectura puede traer varias peticiones y cortar la última: se
+           procesan las líneas completas y el resto espera a la siguiente */
+        char* line = buf;
+        for (char* nl; keep_running && (nl = strchr(line, '\n')); line = nl + 1) {
+            *nl = '\0';
+            Request req;
+            if (parse_request(line, &req) != 0) {
+                continue;
             }
-        }
 
-        /* 6) Ejecutar la petición concreta */
-        handle_request(&req, fd);
+            log_msg(LOG_DEBUG, "Recibida petición op=%d título=\"%s\" ISBN=%d",
+                    req.op, req.title, req.isbn);
+
+            /* 6) Encolarla según su clase, o rechazarla en el acto si el
+               cliente supera su límite o la cola está llena. Q se atiende
+               siempre, como en memoria compartida: si no cabe, aquí mismo */
+            if (adm_submit(&req) != 0) {
+                if (req.op == OP_SALIR) {
+                    handle_request(&req, reply_fd, NULL);
+                } else {
+                    send_busy(&req, reply_fd, NULL);
+                }
+            }
+        }
+        kept = buf + len - line;
+        if (kept == sizeof(buf) - 1) {
+            kept = 0;  /* línea sin '\n' más larga que el búfer: descartar */
+        }
+        memmove(buf, line, kept);
     }
 
     /* 7) Esperar a que terminen los hilos auxiliares antes de salir */
@@ -274,7 +855,9 @@ int main(int argc, char* argv[]) {
     pthread_join(tid2, NULL);
 
     /* 8) Cerrar y borrar el FIFO */
+    close(reply_fd);
     close(fd);
     unlink(fifo_name);
+    logger_shutdown();
     return 0;
 }
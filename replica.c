@@ -0,0 +1,326 @@
+// replica.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "common.h"
+#include "db.h"
+#include "loader.h"
+#include "logger.h"
+#include "replica.h"
+
+#define REPL_BUF          65536
+#define REPL_RETRY_MS     100     // Espera entre intentos de conexión al primario
+#define REPL_IDLE_SECS    1       // Revisión periódica de recargas sin cambios
+
+// Protocolo (texto, primario → réplica):
+//   "S,<bytes>\n" seguido de <bytes> de catálogo en formato base.txt
+//   "M,<estado>,<isbn>,<ejemplar>,<fecha>\n" por cada registro de add_log()
+//   "H,<isbn>,<fifo>\n" por cada reserva encolada, en su lugar entre los "M";
+//                      tras "S" van las reservas que ya esperaban
+
+static int standby = 0;
+static int follow_fd = -1;
+static char serve_path[108];
+
+// Lector con búfer sobre el socket del primario
+typedef struct {
+    int fd;
+    char buf[REPL_BUF];
+    size_t start, end;
+} ReplReader;
+
+static int send_all(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+// Asegura al menos un byte en el búfer; devuelve 0 si hay, -1 en EOF/error
+static int reader_fill(ReplReader *r) {
+    if (r->start < r->end) return 0;
+    ssize_t n;
+    do {
+        n = read(r->fd, r->buf, sizeof(r->buf));
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) return -1;
+    r->start = 0;
+    r->end = n;
+    return 0;
+}
+
+static int reader_line(ReplReader *r, char *out, size_t cap) {
+    size_t len = 0;
+    while (1) {
+        if (reader_fill(r) != 0) return -1;
+        char c = r->buf[r->start++];
+        if (c == '\n') break;
+        if (len + 1 < cap) out[len++] = c;
+    }
+    out[len] = '\0';
+    return 0;
+}
+
+static int reader_exact(ReplReader *r, char *out, size_t len) {
+    while (len > 0) {
+        if (reader_fill(r) != 0) return -1;
+        size_t k = r->end - r->start < len ? r->end - r->start : len;
+        memcpy(out, r->buf + r->start, k);
+        r->start += k;
+        out += k;
+        len -= k;
+    }
+    return 0;
+}
+
+/*
+ * Envía a la réplica conectada en cfd la instantánea y luego los cambios.
+ * Si el catálogo se recarga en el primario se vuelve a enviar completo.
+ * Retorna cuando la réplica se desconecta.
+ */
+static void stream_to_standby(int cfd) {
+    size_t cap = 0, hcap = 0;
+    LogEntry **pending = NULL;
+    HoldEvent **holds = NULL;
+    char *out = NULL;
+    size_t out_cap = 0;
+
+    while (1) {
+        size_t len, catalog_len;
+        LogEntry *last;
+        HoldEvent *hlast;
+        unsigned long version;
+        char *catalog = dump_db(&len, &catalog_len, &last, &hlast, &version);
+        char header[32];
+        int hlen = snprintf(header, sizeof(header), "S,%zu\n", catalog_len);
+        int rc = send_all(cfd, header, hlen);
+        if (rc == 0) rc = send_all(cfd, catalog, len);
+        free(catalog);
+        if (rc != 0) break;
+
+        while (db_version() == version) {
+            pthread_mutex_lock(&log_mux);
+            if (log_head == last && hold_log == hlast) {
+                struct timespec deadline;
+                clock_gettime(CLOCK_REALTIME, &deadline);
+                deadline.tv_sec += REPL_IDLE_SECS;
+                pthread_cond_timedwait(&log_cond, &log_mux, &deadline);
+            }
+            LogEntry *head = log_head;
+            HoldEvent *hhead = hold_log;
+            pthread_mutex_unlock(&log_mux);
+            if (head == last && hhead == hlast) continue;
+
+            // El log y hold_log crecen por la cabeza: juntar los nuevos y
+            // enviarlos del más antiguo al más reciente, todos en un único
+            // send(). Cada reserva va justo después del registro que tenía
+            // el log cuando se encoló.
+            size_t n = 0, nh = 0;
+            for (LogEntry *le = head; le != last; le = le->next) {
+                if (n == cap) {
+                    cap = cap ? cap * 2 : 256;
+                    pending = realloc(pending, cap * sizeof(LogEntry *));
+                }
+                pending[n++] = le;
+            }
+            for (HoldEvent *ev = hhead; ev != hlast; ev = ev->next) {
+                if (nh == hcap) {
+                    hcap = hcap ? hcap * 2 : 64;
+                    holds = realloc(holds, hcap * sizeof(HoldEvent *));
+                }
+                holds[nh++] = ev;
+            }
+            if (out_cap < (n + nh) * MAX_LINE_LEN) {
+                out_cap = (n + nh) * MAX_LINE_LEN;
+                out = realloc(out, out_cap);
+            }
+            size_t used = 0;
+            LogEntry *prev = last;
+            while (1) {
+                while (nh > 0 && holds[nh - 1]->after == prev) {
+                    HoldEvent *ev = holds[--nh];
+                    used += snprintf(out + used, out_cap - used, "H,%d,%s\n",
+                                     ev->isbn, ev->reply_fifo);
+                }
+                if (n == 0) break;
+                LogEntry *le = pending[--n];
+                used += snprintf(out + used, out_cap - used, "M,%c,%d,%d,%s\n",
+                                 le->status, le->isbn, le->ejemplar, le->date);
+                prev = le;
+            }
+            if (send_all(cfd, out, used) != 0) {
+                free(pending);
+                free(holds);
+                free(out);
+                return;
+            }
+            last = head;
+            hlast = hhead;
+        }
+        log_msg(LOG_INFO, "Catálogo recargado: reenviando instantánea a la réplica");
+    }
+    free(pending);
+    free(holds);
+    free(out);
+}
+
+static void* primary_thread(void* arg) {
+    int lfd = (int)(long)arg;
+    while (1) {
+        int cfd = accept(lfd, NULL, NULL);
+        if (cfd < 0) {
+            if (errno == EINTR) continue;
+            log_msg(LOG_ERROR, "Replicación: error en accept (%s)", strerror(errno));
+            break;
+        }
+        log_msg(LOG_INFO, "Réplica conectada; enviando instantánea y cambios");
+        stream_to_standby(cfd);
+        close(cfd);
+        log_msg(LOG_INFO, "Réplica desconectada");
+    }
+    close(lfd);
+    return NULL;
+}
+
+static int start_primary(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lfd < 0) {
+        perror("Error al crear socket de replicación");
+        return -1;
+    }
+    unlink(path);
+    if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, 1) != 0) {
+        perror("Error al escuchar en socket de replicación");
+        close(lfd);
+        return -1;
+    }
+    pthread_t tid;
+    pthread_create(&tid, NULL, primary_thread, (void *)(long)lfd);
+    pthread_detach(tid);
+    return 0;
+}
+
+int replica_serve(const char *path) {
+    strncpy(serve_path, path, sizeof(serve_path) - 1);
+    if (replica_is_standby()) {
+        return 0;    // se arranca en replica_promote()
+    }
+    return start_primary(serve_path);
+}
+
+/*
+ * Hilo de la réplica: conecta con el primario, instala cada instantánea y
+ * aplica los cambios en orden. Si el primario cae, promueve la réplica.
+ */
+static void* follower_thread(void* arg) {
+    char *path = arg;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    free(path);
+
+    int fd = -1;
+    while (replica_is_standby()) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) break;
+        close(fd);
+        fd = -1;
+        struct timespec pause = { 0, REPL_RETRY_MS * 1000000L };
+        nanosleep(&pause, NULL);
+    }
+    if (fd < 0) return NULL;
+    __atomic_store_n(&follow_fd, fd, __ATOMIC_RELEASE);
+    log_msg(LOG_INFO, "Réplica conectada al primario \"%s\"", addr.sun_path);
+
+    ReplReader *r = malloc(sizeof(ReplReader));
+    r->fd = fd;
+    r->start = r->end = 0;
+    char line[MAX_LINE_LEN];
+    while (replica_is_standby() && reader_line(r, line, sizeof(line)) == 0) {
+        if (line[0] == 'S') {
+            size_t len = strtoul(line + 2, NULL, 10);
+            char *catalog = malloc(len ? len : 1);
+            if (reader_exact(r, catalog, len) != 0) {
+                free(catalog);
+                break;
+            }
+            BookNode *head = NULL;
+            parse_catalog_mem("primario", catalog, len, &head);
+            free(catalog);
+            install_db(head);
+            log_msg(LOG_INFO, "Réplica: instantánea del primario instalada (%zu bytes)", len);
+        } else if (line[0] == 'M') {
+            char status;
+            int isbn, ejemplar;
+            char date[DATE_STR_LEN];
+            if (sscanf(line, "M,%c,%d,%d,%10s", &status, &isbn, &ejemplar, date) == 4 &&
+                apply_mutation(status, isbn, ejemplar, date) != 0) {
+                log_msg(LOG_ERROR, "Réplica: cambio no aplicable \"%s\"", line);
+            }
+        } else if (line[0] == 'H') {
+            int isbn;
+            char fifo[FIFO_NAME_LEN];
+            if (sscanf(line, "H,%d,%63[^\n]", &isbn, fifo) == 2 &&
+                apply_hold(isbn, fifo) != 0) {
+                log_msg(LOG_ERROR, "Réplica: reserva no aplicable \"%s\"", line);
+            }
+        }
+    }
+    free(r);
+
+    if (replica_is_standby()) {
+        log_msg(LOG_ERROR, "Conexión con el primario perdida: promoviendo réplica");
+        replica_promote();
+    }
+    close(fd);
+    return NULL;
+}
+
+int replica_follow(const char *path) {
+    __atomic_store_n(&standby, 1, __ATOMIC_RELEASE);
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, follower_thread, strdup(path)) != 0) {
+        __atomic_store_n(&standby, 0, __ATOMIC_RELEASE);
+        return -1;
+    }
+    pthread_detach(tid);
+    return 0;
+}
+
+int replica_is_standby(void) {
+    return __atomic_load_n(&standby, __ATOMIC_ACQUIRE);
+}
+
+void replica_promote(void) {
+    if (!__atomic_exchange_n(&standby, 0, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    // Cortar el flujo del primario para que el hilo seguidor termine
+    int fd = __atomic_load_n(&follow_fd, __ATOMIC_ACQUIRE);
+    if (fd >= 0) {
+        shutdown(fd, SHUT_RDWR);
+    }
+    log_msg(LOG_INFO, "Réplica promovida a primario: se aceptan préstamos y devoluciones");
+    if (serve_path[0]) {
+        start_primary(serve_path);
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef REPLICA_H
+#define REPLICA_H
+
+// Primario: escucha en el socket local path y envía a la réplica conectada
+// una instantánea del catálogo y de las colas de reserva seguida de cada
+// cambio P/R/D y de cada reserva encolada, en el orden en que ocurrieron.
+// Si el receptor es réplica, el envío empieza al promoverlo.
+// Límite: el aviso de una reserva atendida lo da sólo el primario; si cae
+// entre la devolución y el aviso, la réplica ya la tiene por entregada.
+// Devuelve 0 si se lanzó (o quedó pendiente), -1 si falló.
+int replica_serve(const char *path);
+
+// Réplica: se conecta al primario por el socket local path y aplica su
+// flujo de cambios. Mientras sea réplica sólo atiende consultas.
+// Si se pierde la conexión con el primario, se promueve sola.
+int replica_follow(const char *path);
+
+// Indica si el receptor es (todavía) una réplica de sólo lectura
+int replica_is_standby(void);
+
+// Promueve la réplica a primario: deja de aplicar el flujo y acepta escrituras
+void replica_promote(void);
+
+#endif // REPLICA_H
@@ -0,0 +1,220 @@
+// report.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "report.h"
+
+#define REPORT_THREADS      4        // Hilos para consultas sobre logs grandes
+#define REPORT_MIN_PER_THR  50000    // Registros mínimos para repartir en hilos
+#define DEFAULT_TOP         10
+
+// Contadores agregados de un título
+typedef struct {
+    int isbn;
+    const char *title;
+    long count[3];                   // P, R, D
+} TitleAgg;
+
+// Tabla hash abierta ISBN → TitleAgg
+typedef struct {
+    TitleAgg *slots;
+    size_t cap, used;
+} AggTable;
+
+// Trabajo de un hilo: un tramo de la instantánea del log
+typedef struct {
+    LogEntry **entries;
+    size_t begin, end;
+    const ReportQuery *q;
+    char *match;                     // match[i] = 1 si entries[i] cumple la consulta
+    AggTable agg;
+} ReportJob;
+
+static int status_index(char status) {
+    return status == 'P' ? 0 : status == 'R' ? 1 : 2;
+}
+
+// "DD-MM-YYYY" → AAAAMMDD para poder comparar rangos de fechas
+static int date_key(const char *date) {
+    int d, m, y;
+    if (sscanf(date, "%2d-%2d-%4d", &d, &m, &y) != 3) return -1;
+    return y * 10000 + m * 100 + d;
+}
+
+static void agg_init(AggTable *t, size_t cap) {
+    t->cap = cap;
+    t->used = 0;
+    t->slots = calloc(cap, sizeof(TitleAgg));
+}
+
+static TitleAgg *agg_slot(AggTable *t, int isbn) {
+    size_t i = ((unsigned)isbn * 2654435761u) & (t->cap - 1);
+    while (t->slots[i].isbn && t->slots[i].isbn != isbn) {
+        i = (i + 1) & (t->cap - 1);
+    }
+    return &t->slots[i];
+}
+
+static TitleAgg *agg_get(AggTable *t, int isbn, const char *title) {
+    if ((t->used + 1) * 10 > t->cap * 7) {
+        // Duplicar la tabla al superar el 70% de ocupación
+        AggTable bigger;
+        agg_init(&bigger, t->cap * 2);
+        for (size_t i = 0; i < t->cap; i++) {
+            if (t->slots[i].isbn) *agg_slot(&bigger, t->slots[i].isbn) = t->slots[i];
+        }
+        bigger.used = t->used;
+        free(t->slots);
+        *t = bigger;
+    }
+    TitleAgg *a = agg_slot(t, isbn);
+    if (!a->isbn) {
+        a->isbn = isbn;
+        a->title = title;
+        t->used++;
+    }
+    return a;
+}
+
+static int entry_matches(const LogEntry *le, const ReportQuery *q) {
+    if (q->isbn && le->isbn != q->isbn) return 0;
+    if (q->status && le->status != q->status) return 0;
+    if (q->from || q->to) {
+        int key = date_key(le->op_date);
+        if (q->from && key < q->from) return 0;
+        if (q->to && key > q->to) return 0;
+    }
+    return 1;
+}
+
+static void *report_worker(void *arg) {
+    ReportJob *job = arg;
+    agg_init(&job->agg, 64);
+    for (size_t i = job->begin; i < job->end; i++) {
+        LogEntry *le = job->entries[i];
+        if (!entry_matches(le, job->q)) continue;
+        job->match[i] = 1;
+        agg_get(&job->agg, le->isbn, le->title)->count[status_index(le->status)]++;
+    }
+    return NULL;
+}
+
+// Más préstamos primero; a igualdad, más actividad total
+static int cmp_busiest(const void *a, const void *b) {
+    const TitleAgg *x = a, *y = b;
+    if (x->count[0] != y->count[0]) return x->count[0] < y->count[0] ? 1 : -1;
+    long tx = x->count[0] + x->count[1] + x->count[2];
+    long ty = y->count[0] + y->count[1] + y->count[2];
+    return (tx < ty) - (tx > ty);
+}
+
+int parse_report_query(const char *text, ReportQuery *q) {
+    memset(q, 0, sizeof(*q));
+    q->top = DEFAULT_TOP;
+
+    char buf[MAX_LINE_LEN];
+    strncpy(buf, text, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    for (char *tok = strtok(buf, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n")) {
+        char *val = strchr(tok, '=');
+        if (!val) return -1;
+        *val++ = '\0';
+        if (strcmp(tok, "isbn") == 0) {
+            q->isbn = atoi(val);
+        } else if (strcmp(tok, "estado") == 0) {
+            char c = val[0];
+            if (c >= 'a' && c <= 'z') c -= 32;
+            if (c != 'P' && c != 'R' && c != 'D') return -1;
+            q->status = c;
+        } else if (strcmp(tok, "desde") == 0) {
+            if ((q->from = date_key(val)) < 0) return -1;
+        } else if (strcmp(tok, "hasta") == 0) {
+            if ((q->to = date_key(val)) < 0) return -1;
+        } else if (strcmp(tok, "top") == 0) {
+            q->top = atoi(val);
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void run_report(const ReportQuery *q, FILE *out) {
+    // Instantánea: los nodos del log no se modifican una vez publicados y
+    // sólo se insertan al inicio, así que basta con fijar la cabeza.
+    pthread_mutex_lock(&log_mux);
+    LogEntry *head = log_head;
+    pthread_mutex_unlock(&log_mux);
+
+    size_t n = 0;
+    for (LogEntry *le = head; le; le = le->next) n++;
+    LogEntry **entries = malloc((n ? n : 1) * sizeof(LogEntry *));
+    char *match = calloc(n ? n : 1, 1);
+    size_t k = 0;
+    for (LogEntry *le = head; le; le = le->next) entries[k++] = le;
+
+    int nthreads = n >= REPORT_MIN_PER_THR * 2 ? REPORT_THREADS : 1;
+    ReportJob jobs[REPORT_THREADS];
+    pthread_t tids[REPORT_THREADS];
+    for (int i = 0; i < nthreads; i++) {
+        jobs[i].entries = entries;
+        jobs[i].begin = n * i / nthreads;
+        jobs[i].end = n * (i + 1) / nthreads;
+        jobs[i].q = q;
+        jobs[i].match = match;
+        if (nthreads > 1) pthread_create(&tids[i], NULL, report_worker, &jobs[i]);
+        else              report_worker(&jobs[i]);
+    }
+
+    // Unir los agregados parciales de cada hilo
+    AggTable total;
+    agg_init(&total, 64);
+    for (int i = 0; i < nthreads; i++) {
+        if (nthreads > 1) pthread_join(tids[i], NULL);
+        AggTable *t = &jobs[i].agg;
+        for (size_t s = 0; s < t->cap; s++) {
+            TitleAgg *src = &t->slots[s];
+            if (!src->isbn) continue;
+            TitleAgg *dst = agg_get(&total, src->isbn, src->title);
+            for (int c = 0; c < 3; c++) dst->count[c] += src->count[c];
+        }
+        free(t->slots);
+    }
+
+    long sums[3] = {0, 0, 0};
+    size_t matched = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!match[i]) continue;
+        LogEntry *le = entries[i];
+        fprintf(out, "%c, %s, %d, %d, %s\n",
+                le->status, le->title, le->isbn, le->ejemplar, le->date);
+        sums[status_index(le->status)]++;
+        matched++;
+    }
+
+    fprintf(out, "-- %zu de %zu registros: %ld préstamos, %ld renovaciones, %ld devoluciones\n",
+            matched, n, sums[0], sums[1], sums[2]);
+
+    if (q->top > 0 && total.used > 0) {
+        TitleAgg *list = malloc(total.used * sizeof(TitleAgg));
+        size_t m = 0;
+        for (size_t s = 0; s < total.cap; s++) {
+            if (total.slots[s].isbn) list[m++] = total.slots[s];
+        }
+        qsort(list, m, sizeof(TitleAgg), cmp_busiest);
+        fprintf(out, "-- Títulos más prestados (préstamos, renovaciones, devoluciones):\n");
+        for (size_t i = 0; i < m && i < (size_t)q->top; i++) {
+            fprintf(out, "%s, %d: %ld, %ld, %ld\n",
+                    list[i].title, list[i].isbn,
+                    list[i].count[0], list[i].count[1], list[i].count[2]);
+        }
+        free(list);
+    }
+
+    free(total.slots);
+    free(match);
+    free(entries);
+}
@@ -0,0 +1,27 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdio.h>
+#include "common.h"
+
+// Filtros y agregados de una consulta sobre la lista de logs
+typedef struct {
+    int isbn;       // 0 = cualquier ISBN
+    char status;    // 'P', 'R', 'D' o 0 = cualquiera
+    int from;       // fecha mínima como AAAAMMDD (0 = sin límite)
+    int to;         // fecha máxima como AAAAMMDD (0 = sin límite)
+    int top;        // títulos más activos a mostrar en el resumen
+} ReportQuery;
+
+// Interpreta "isbn=N estado=P desde=DD-MM-YYYY hasta=DD-MM-YYYY top=N"
+// (todos los campos son opcionales). desde/hasta se comparan con el día en
+// que se registró la operación, no con la fecha de devolución de P/R.
+// Devuelve 0 si es válida, -1 si no.
+int parse_report_query(const char *text, ReportQuery *q);
+
+// Imprime los registros que cumplen la consulta y un resumen con totales
+// por estado y préstamos por título. Trabaja sobre una instantánea de la
+// lista de logs: log_mux sólo se toma para leer log_head.
+void run_report(const ReportQuery *q, FILE *out);
+
+#endif // REPORT_H
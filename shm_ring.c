@@ -0,0 +1,143 @@
+// shm_ring.c
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "shm_ring.h"
+
+#define SHM_SPIN  200    // Reintentos activos antes de dormir en el futex
+
+// Futex compartido entre procesos (sin FUTEX_PRIVATE_FLAG)
+static void futex_wait(atomic_uint* addr, unsigned val, const struct timespec* timeout) {
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, timeout, NULL, 0);
+}
+
+static void futex_wake(atomic_uint* addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static ShmChannel* map_channel(int fd) {
+    void* p = mmap(NULL, sizeof(ShmChannel), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        perror("Error al mapear memoria compartida");
+        return NULL;
+    }
+    return p;
+}
+
+ShmChannel* shm_channel_create(const char* name) {
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        perror("Error al crear memoria compartida");
+        return NULL;
+    }
+    // ftruncate deja la región en ceros: anillos vacíos y contadores a 0
+    if (ftruncate(fd, sizeof(ShmChannel)) != 0) {
+        perror("Error al dimensionar memoria compartida");
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    return map_channel(fd);
+}
+
+ShmChannel* shm_channel_attach(const char* name) {
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(ShmChannel)) {
+        close(fd);
+        return NULL;
+    }
+    return map_channel(fd);
+}
+
+void shm_channel_detach(ShmChannel* ch) {
+    munmap(ch, sizeof(ShmChannel));
+}
+
+// Espera hasta que cond_ready() se cumpla, durmiendo en bell si hace falta.
+// El orden "publicar waiting, volver a comprobar, dormir" evita perder un
+// timbre que llegue entre la comprobación y el futex_wait. Con timeout, si
+// tras dormir la condición sigue sin cumplirse se abandona con expired = 1.
+#define RING_WAIT(cond_ready, bell, waiting, timeout, expired)   \
+    do {                                                         \
+        for (int spin = 0; !(cond_ready); spin++) {              \
+            if (spin < SHM_SPIN) continue;                       \
+            unsigned seq = atomic_load(&(bell));                 \
+            atomic_store(&(waiting), 1);                         \
+            if (!(cond_ready)) futex_wait(&(bell), seq, timeout);\
+            atomic_store(&(waiting), 0);                         \
+            if ((timeout) && !(cond_ready)) {                    \
+                (expired) = 1;                                   \
+                break;                                           \
+            }                                                    \
+        }                                                        \
+    } while (0)
+
+static struct timespec* ms_to_timeout(int timeout_ms, struct timespec* ts) {
+    if (timeout_ms < 0) {
+        return NULL;
+    }
+    ts->tv_sec = timeout_ms / 1000;
+    ts->tv_nsec = (timeout_ms % 1000) * 1000000L;
+    return ts;
+}
+
+void shm_ring_push(ShmRing* r, const char* line) {
+    shm_ring_push_timeout(r, line, -1);
+}
+
+void shm_ring_pop(ShmRing* r, char* out) {
+    shm_ring_pop_timeout(r, out, -1);
+}
+
+int shm_ring_push_timeout(ShmRing* r, const char* line, int timeout_ms) {
+    struct timespec ts;
+    struct timespec* timeout = ms_to_timeout(timeout_ms, &ts);
+    int expired = 0;
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    RING_WAIT(head - atomic_load(&r->tail) < SHM_RING_SLOTS,
+              r->space_bell, r->space_waiting, timeout, expired);
+    if (expired) {
+        return -1;
+    }
+
+    char* slot = r->slots[head % SHM_RING_SLOTS];
+    strncpy(slot, line, MAX_LINE_LEN - 1);
+    slot[MAX_LINE_LEN - 1] = '\0';
+    atomic_store(&r->head, head + 1);
+
+    atomic_fetch_add(&r->data_bell, 1);
+    if (atomic_load(&r->data_waiting)) futex_wake(&r->data_bell);
+    return 0;
+}
+
+int shm_ring_pop_timeout(ShmRing* r, char* out, int timeout_ms) {
+    struct timespec ts;
+    struct timespec* timeout = ms_to_timeout(timeout_ms, &ts);
+    int expired = 0;
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    RING_WAIT(atomic_load(&r->head) != tail,
+              r->data_bell, r->data_waiting, timeout, expired);
+    if (expired) {
+        return -1;
+    }
+
+    memcpy(out, r->slots[tail % SHM_RING_SLOTS], MAX_LINE_LEN);
+    out[MAX_LINE_LEN - 1] = '\0';   // el slot lo escribe el otro proceso
+    atomic_store(&r->tail, tail + 1);
+
+    atomic_fetch_add(&r->space_bell, 1);
+    if (atomic_load(&r->space_waiting)) futex_wake(&r->space_bell);
+    return 0;
+}
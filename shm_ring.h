@@ -0,0 +1,51 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "common.h"
+
+#define SHM_RING_SLOTS  64
+#define SHM_NAME_LEN    32
+
+// Anillo SPSC de registros de texto de tamaño fijo en memoria compartida.
+// Los contadores *_bell hacen de timbre: se esperan con futex sólo cuando
+// el anillo está vacío (o lleno), así que en régimen no hay syscalls.
+typedef struct {
+    atomic_uint head;            // próximo slot a escribir (productor)
+    atomic_uint tail;            // próximo slot a leer (consumidor)
+    atomic_uint data_bell;       // se incrementa en cada push
+    atomic_uint data_waiting;    // consumidor dormido esperando datos
+    atomic_uint space_bell;      // se incrementa en cada pop
+    atomic_uint space_waiting;   // productor dormido esperando hueco
+    char slots[SHM_RING_SLOTS][MAX_LINE_LEN];
+} ShmRing;
+
+// Región compartida por un solicitante y el receptor
+typedef struct {
+    ShmRing req;                 // solicitante → receptor
+    ShmRing rep;                 // receptor → solicitante
+} ShmChannel;
+
+// Crea (solicitante) o se conecta (receptor) a la región "name" de
+// shm_open. Devuelven NULL si falla.
+ShmChannel* shm_channel_create(const char* name);
+ShmChannel* shm_channel_attach(const char* name);
+
+// Desmapea la región; el creador además debe llamar a shm_unlink(name)
+void shm_channel_detach(ShmChannel* ch);
+
+// Copia una línea al anillo; espera si está lleno
+void shm_ring_push(ShmRing* r, const char* line);
+
+// Extrae una línea del anillo en out (MAX_LINE_LEN, siempre terminada en
+// '\0' aunque el otro lado haya llenado el slot); espera si está vacío
+void shm_ring_pop(ShmRing* r, char* out);
+
+// Como push/pop, pero si el anillo sigue lleno (o vacío) tras esperar
+// timeout_ms devuelven -1; timeout_ms < 0 espera sin límite.
+int shm_ring_push_timeout(ShmRing* r, const char* line, int timeout_ms);
+int shm_ring_pop_timeout(ShmRing* r, char* out, int timeout_ms);
+
+#endif // SHM_RING_H
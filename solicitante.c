@@ -7,18 +7,113 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include "common.h"
+#include "shm_ring.h"
 
 static char fifo_name[FIFO_NAME_LEN]; 
+static char reply_name[FIFO_NAME_LEN];
+static char shm_name[SHM_NAME_LEN];
+static ShmChannel* shm = NULL;          /* != NULL si se usa memoria compartida (-m) */
+
+/* Buzón de una respuesta: lo llena reply_reader y lo vacía wait_reply */
+static pthread_mutex_t reply_mux = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reply_cond = PTHREAD_COND_INITIALIZER;
+static char reply_line[MAX_LINE_LEN];
+static int reply_ready = 0;
+
+/*
+ * Hilo lector del FIFO propio de respuesta. Los avisos de reservas
+ * (“OK,Reserva,…”) llegan en cualquier momento y se muestran al instante;
+ * el resto son respuestas a la última petición y se dejan en el buzón.
+ */
+static void* reply_reader(void* arg) {
+    int rfd = *(int*)arg;
+    char buf[PIPE_BUF + 1];
+    while (1) {
+        ssize_t n = read(rfd, buf, sizeof(buf) - 1);
+        if (n <= 0) continue;
+        buf[n] = '\0';
+        char* save;
+        for (char* line = strtok_r(buf, "\n", &save); line;
+             line = strtok_r(NULL, "\n", &save)) {
+            if (strncmp(line, "OK,Reserva,", 11) == 0) {
+                printf("\nAviso: ejemplar reservado disponible: %s\n", line);
+                fflush(stdout);
+                continue;
+            }
+            pthread_mutex_lock(&reply_mux);
+            snprintf(reply_line, sizeof(reply_line), "%s\n", line);
+            reply_ready = 1;
+            pthread_cond_signal(&reply_cond);
+            pthread_mutex_unlock(&reply_mux);
+        }
+    }
+    return NULL;
+}
+
+/* Espera la respuesta a la última petición enviada */
+static void wait_reply(char* resp) {
+    pthread_mutex_lock(&reply_mux);
+    while (!reply_ready) {
+        pthread_cond_wait(&reply_cond, &reply_mux);
+    }
+    strcpy(resp, reply_line);
+    reply_ready = 0;
+    pthread_mutex_unlock(&reply_mux);
+}
+
+/* Envía una línea de petición y espera su respuesta por el transporte activo */
+static void transact(int fd, const char* msg, char* resp) {
+    if (shm) {
+        shm_ring_push(&shm->req, msg);
+        shm_ring_pop(&shm->rep, resp);
+    } else {
+        write(fd, msg, strlen(msg));
+        wait_reply(resp);
+    }
+}
+
+/* Envía “Op,Título,ISBN,FIFOrespuesta\n” al receptor y lee la respuesta */
+static void send_request(int fd, char op, const char* title, int isbn, char* resp) {
+    char msg[MAX_LINE_LEN];
+    snprintf(msg, sizeof(msg), "%c,%s,%d,%s\n", op, title, isbn, reply_name);
+    transact(fd, msg, resp);
+}
+
+/*
+ * Crea la región de memoria compartida "/sol_<pid>" y pide al receptor,
+ * por el FIFO, que atienda a este cliente por ella. Devuelve 0 si aceptó.
+ */
+static int connect_shm(int fd) {
+    snprintf(shm_name, sizeof(shm_name), "/sol_%d", (int)getpid());
+    shm_unlink(shm_name);
+    ShmChannel* ch = shm_channel_create(shm_name);
+    if (!ch) {
+        return -1;
+    }
+    char resp[MAX_LINE_LEN];
+    send_request(fd, 'M', shm_name, 0, resp);
+    if (strncmp(resp, "OK,Memoria", 10) != 0) {
+        shm_channel_detach(ch);
+        shm_unlink(shm_name);
+        return -1;
+    }
+    shm = ch;
+    return 0;
+}
 
 /*
  * Modo interactivo:
- *   - P/R/D: pide Título e ISBN → envía "Op,Título,ISBN\n" → lee respuesta real.
- *   - Q: envía "Q,Salir,0\n", lee "BYE\n", luego sale.
+ *   - P/R/D/H: pide Título e ISBN → envía "Op,Título,ISBN,FIFO\n" → lee respuesta real.
+ *   - H: si no hay ejemplar libre queda en espera; el aviso llega después.
+ *   - Q: envía "Q,Salir,0,FIFO\n", lee "BYE\n", luego sale.
  */
 void interactive(int fd) {
     while (1) {
-        printf("Operación (P=Préstamo, R=Renovar, D=Devolver, Q=Salir): ");
+        printf("Operación (P=Préstamo, R=Renovar, D=Devolver, H=Reservar, C=Consultar, Q=Salir): ");
         char op = getchar();
         /* Consumir resto de línea */
         while (getchar() != '\n');
@@ -27,31 +122,20 @@ void interactive(int fd) {
         if (op >= 'a' && op <= 'z') {
             op -= 32;
         }
-        if (op != 'P' && op != 'R' && op != 'D' && op != 'Q') {
+        if (op != 'P' && op != 'R' && op != 'D' && op != 'H' && op != 'C' && op != 'Q') {
             printf("Opción no válida. Intente de nuevo.\n");
             continue;
         }
 
         if (op == 'Q') {
-            /* Enviar cierre */
-            char msg[] = "Q,Salir,0\n";
-            write(fd, msg, strlen(msg));
-            /* Leer respuesta "BYE\n" real */
+            /* Enviar cierre y esperar "BYE\n" */
             char resp[MAX_LINE_LEN];
-            while (1) {
-                ssize_t n = read(fd, resp, sizeof(resp) - 1);
-                if (n <= 0) continue;
-                resp[n] = '\0';
-                /* Si es “Q,Salir,0” (eco), se ignora */
-                if (resp[0] == 'Q') continue;
-                /* Llegó BYE */
-                printf("%s", resp);
-                break;
-            }
+            send_request(fd, 'Q', "Salir", 0, resp);
+            printf("%s", resp);
             break;
         }
 
-        /* Para P/R/D pedimos título e ISBN */
+        /* Para P/R/D/H pedimos título e ISBN */
         printf("Título: ");
         char title[MAX_TITLE_LEN];
         fgets(title, sizeof(title), stdin);
@@ -66,35 +150,20 @@ void interactive(int fd) {
         }
         while (getchar() != '\n');  // desechar '\n'
 
-        /* Enviar “Op,Título,ISBN\n” */
-        char msg[MAX_LINE_LEN];
-        snprintf(msg, sizeof(msg), "%c,%s,%d\n", op, title, isbn);
-        write(fd, msg, strlen(msg));
-
-        /* Luego, leer la respuesta real: “OK...” o “FAIL...” */
+        /* Enviar la petición y leer la respuesta real: “OK...” o “FAIL...” */
         char resp[MAX_LINE_LEN];
-        while (1) {
-            ssize_t n = read(fd, resp, sizeof(resp) - 1);
-            if (n <= 0) continue;
-            resp[n] = '\0';
-            /* Si es eco “P,…” o “R,…” o “D,…” lo ignoramos */
-            char c0 = resp[0];
-            if (c0 == 'P' || c0 == 'R' || c0 == 'D' || c0 == 'Q') {
-                continue;
-            }
-            /* Llegó “OK,…\n” o “FAIL,…\n” */
-            printf("Respuesta: %s", resp);
-            break;
-        }
+        send_request(fd, op, title, isbn, resp);
+        printf("Respuesta: %s", resp);
     }
 }
 
 int main(int argc, char *argv[]) {
     int opt;
     int use_file = 0;
+    int use_shm = 0;
     char file_arg[128] = {0};
 
-    while ((opt = getopt(argc, argv, "i:p:")) != -1) {
+    while ((opt = getopt(argc, argv, "i:p:m")) != -1) {
         switch (opt) {
             case 'i':
                 use_file = 1;
@@ -103,8 +172,11 @@ int main(int argc, char *argv[]) {
             case 'p':
                 strncpy(fifo_name, optarg, FIFO_NAME_LEN);
                 break;
+            case 'm':
+                use_shm = 1;
+                break;
             default:
-                fprintf(stderr, "Uso: %s [-i archivo] -p pipeReceptor\n", argv[0]);
+                fprintf(stderr, "Uso: %s [-i archivo] [-m] -p pipeReceptor\n", argv[0]);
                 exit(1);
         }
     }
@@ -113,39 +185,61 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    /* Abrir el mismo FIFO una sola vez en modo O_RDWR */
+    /* Abrir el FIFO del receptor para enviar peticiones */
     int fd = open(fifo_name, O_RDWR);
     if (fd < 0) {
         perror("Error al abrir el FIFO");
         exit(1);
     }
 
+    /* Crear el FIFO propio de respuesta “<pipe>.<pid>”; se mantiene abierto
+       en O_RDWR para que el receptor pueda escribir avisos en cualquier momento */
+    if (snprintf(reply_name, sizeof(reply_name), "%s.%d", fifo_name, (int)getpid())
+            >= (int)sizeof(reply_name)) {
+        fprintf(stderr, "Error: nombre de pipe demasiado largo.\n");
+        exit(1);
+    }
+    unlink(reply_name);
+    if (mkfifo(reply_name, 0666) != 0) {
+        perror("Error al crear el FIFO de respuesta");
+        exit(1);
+    }
+    int rfd = open(reply_name, O_RDWR);
+    if (rfd < 0) {
+        perror("Error al abrir el FIFO de respuesta");
+        unlink(reply_name);
+        exit(1);
+    }
+    pthread_t reader_tid;
+    pthread_create(&reader_tid, NULL, reply_reader, &rfd);
+
+    /* -m: pasar a memoria compartida; si el receptor no acepta, seguir por FIFO */
+    if (use_shm && connect_shm(fd) != 0) {
+        fprintf(stderr, "Aviso: no se pudo usar memoria compartida; se usa el FIFO.\n");
+    }
+
     if (use_file) {
-        /* Versión “desde archivo” (opcional, no la usaremos para ahora) */
+        /* Versión “desde archivo” */
         FILE *f = fopen(file_arg, "r");
         if (!f) {
             perror("Error al abrir archivo de peticiones");
             close(fd);
+            unlink(reply_name);
+            if (shm) shm_unlink(shm_name);
             exit(1);
         }
         char line[MAX_LINE_LEN];
         while (fgets(line, sizeof(line), f)) {
             if (line[0] == '#' || strlen(line) <= 1) continue;
-            write(fd, line, strlen(line));
-            /* Leer respuesta real (ignorar ecos) */
+            /* Añadir el FIFO de respuesta como cuarto campo */
+            char msg[MAX_LINE_LEN + FIFO_NAME_LEN + 2];
+            line[strcspn(line, "\r\n")] = '\0';
+            snprintf(msg, sizeof(msg), "%s,%s\n", line, reply_name);
+            /* Enviar y leer respuesta real */
             char resp[MAX_LINE_LEN];
-            while (1) {
-                ssize_t n = read(fd, resp, sizeof(resp) - 1);
-                if (n <= 0) continue;
-                resp[n] = '\0';
-                if (resp[0] == 'P' || resp[0] == 'R' || resp[0] == 'D' || resp[0] == 'Q')
-                    continue;
-                printf("Respuesta: %s", resp);
-                if (strncmp(resp, "BYE", 3) == 0) {
-                    fclose(f);
-                    close(fd);
-                    return 0;
-                }
+            transact(fd, msg, resp);
+            printf("Respuesta: %s", resp);
+            if (strncmp(resp, "BYE", 3) == 0) {
                 break;
             }
             if (line[0] == 'Q') break;
@@ -156,5 +250,11 @@ int main(int argc, char *argv[]) {
     }
 
     close(fd);
+    close(rfd);
+    unlink(reply_name);
+    if (shm) {
+        shm_channel_detach(shm);
+        shm_unlink(shm_name);
+    }
     return 0;
 }